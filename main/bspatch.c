@@ -0,0 +1,206 @@
+/*
+ * bspatch.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Streaming bsdiff patch applier for the ENDSLEY/BSDIFF43 format (https://github.com/mendsley/bsdiff),
+ * without the bzip2 layer so the patch can be fed as it arrives.
+ *
+ * Patch layout, all integers are 8 byte little endian sign-magnitude:
+ *   "ENDSLEY/BSDIFF43" <new size>
+ *   repeated until the new image is complete:
+ *     <diff len> <extra len> <seek>
+ *     <diff len bytes>   new = old + diff, byte by byte, starting at the current old position
+ *     <extra len bytes>  copied to the new image as they are
+ *     the old position moves by seek
+ */
+
+#include <string.h>
+
+#include "bspatch.h"
+#include "sys/param.h"
+
+#define BSPATCH_MAGIC			"ENDSLEY/BSDIFF43"
+#define BSPATCH_MAGIC_LEN		16
+
+// Largest new image accepted, far beyond any partition, so sums of positions stay far from int64_t overflow
+#define BSPATCH_MAX_NEW_SIZE	INT32_MAX
+
+/**
+ * Decodes an 8 byte sign-magnitude integer.
+ */
+static int64_t bspatch_offtin(const uint8_t *buf)
+{
+	int64_t y = buf[7] & 0x7F;
+
+	for (int i = 6; i >= 0; i--)
+	{
+		y = (y << 8) | buf[i];
+	}
+
+	return (buf[7] & 0x80) ? -y : y;
+}
+
+/**
+ * Moves on to the next block once the current one is complete.
+ */
+static void bspatch_settle(bspatch_t *patch)
+{
+	if (patch->state == BSPATCH_STATE_DIFF && patch->diff_len == 0)
+	{
+		patch->state = BSPATCH_STATE_EXTRA;
+	}
+
+	if (patch->state == BSPATCH_STATE_EXTRA && patch->extra_len == 0)
+	{
+		patch->old_pos += patch->seek;
+		patch->state = (patch->new_pos == patch->new_size) ? BSPATCH_STATE_DONE : BSPATCH_STATE_CONTROL;
+	}
+}
+
+/**
+ * Reads len bytes of the old image at the current old position into old_block, bytes outside the old image read as zero.
+ * @return 0 on success, otherwise the value returned by the read callback.
+ */
+static int bspatch_read_old(bspatch_t *patch, size_t len)
+{
+	int64_t start = MAX(patch->old_pos, 0);
+	int64_t end = MIN(patch->old_pos + (int64_t)len, (int64_t)patch->old_size);
+
+	memset(patch->old_block, 0, len);
+	if (start < end)
+	{
+		return patch->read_old(patch->ctx, start, &patch->old_block[start - patch->old_pos], end - start);
+	}
+
+	return 0;
+}
+
+void bspatch_init(bspatch_t *patch, size_t old_size, bspatch_read_cb_t read_old, bspatch_output_cb_t on_output, void *ctx)
+{
+	memset(patch, 0, sizeof(*patch));
+	patch->state = BSPATCH_STATE_HEADER;
+	patch->old_size = old_size;
+	patch->read_old = read_old;
+	patch->on_output = on_output;
+	patch->ctx = ctx;
+}
+
+int bspatch_feed(bspatch_t *patch, const uint8_t *data, size_t len)
+{
+	int ret;
+
+	while (len > 0)
+	{
+		size_t chunk;
+
+		switch (patch->state)
+		{
+			case BSPATCH_STATE_HEADER:
+			case BSPATCH_STATE_CONTROL:
+				chunk = MIN(len, sizeof(patch->field) - patch->field_len);
+				memcpy(&patch->field[patch->field_len], data, chunk);
+				patch->field_len += chunk;
+				data += chunk;
+				len -= chunk;
+				if (patch->field_len < sizeof(patch->field))
+				{
+					break;
+				}
+				patch->field_len = 0;
+
+				if (patch->state == BSPATCH_STATE_HEADER)
+				{
+					patch->new_size = bspatch_offtin(&patch->field[BSPATCH_MAGIC_LEN]);
+					if (memcmp(patch->field, BSPATCH_MAGIC, BSPATCH_MAGIC_LEN) != 0 || patch->new_size < 0 || patch->new_size > BSPATCH_MAX_NEW_SIZE)
+					{
+						patch->state = BSPATCH_STATE_ERROR;
+						break;
+					}
+					patch->state = (patch->new_size == 0) ? BSPATCH_STATE_DONE : BSPATCH_STATE_CONTROL;
+				}
+				else
+				{
+					patch->diff_len = bspatch_offtin(&patch->field[0]);
+					patch->extra_len = bspatch_offtin(&patch->field[8]);
+					patch->seek = bspatch_offtin(&patch->field[16]);
+
+					// Both blocks have to fit into the new image. The lengths come from the patch, so they are
+					// compared with what is left instead of being added up, which could overflow
+					if (patch->diff_len < 0 || patch->extra_len < 0 || patch->diff_len > patch->new_size - patch->new_pos ||
+						patch->extra_len > patch->new_size - patch->new_pos - patch->diff_len)
+					{
+						patch->state = BSPATCH_STATE_ERROR;
+						break;
+					}
+
+					// The old position may leave the old image, where it reads zeros, but never by more than the new image is long
+					int64_t bound = (int64_t)patch->old_size + patch->new_size;
+					int64_t seek_from = patch->old_pos + patch->diff_len;
+					if (patch->seek < -bound - seek_from || patch->seek > bound - seek_from)
+					{
+						patch->state = BSPATCH_STATE_ERROR;
+						break;
+					}
+					patch->state = BSPATCH_STATE_DIFF;
+					bspatch_settle(patch);
+				}
+				break;
+
+			case BSPATCH_STATE_DIFF:
+				chunk = MIN(MIN(len, (size_t)patch->diff_len), BSPATCH_BLOCK_SIZE);
+				if ((ret = bspatch_read_old(patch, chunk)) != 0)
+				{
+					patch->state = BSPATCH_STATE_ERROR;
+					return ret;
+				}
+				for (size_t i = 0; i < chunk; i++)
+				{
+					patch->new_block[i] = patch->old_block[i] + data[i];
+				}
+				if ((ret = patch->on_output(patch->ctx, patch->new_block, chunk)) != 0)
+				{
+					patch->state = BSPATCH_STATE_ERROR;
+					return ret;
+				}
+				patch->old_pos += chunk;
+				patch->new_pos += chunk;
+				patch->diff_len -= chunk;
+				data += chunk;
+				len -= chunk;
+				bspatch_settle(patch);
+				break;
+
+			case BSPATCH_STATE_EXTRA:
+				// Extra bytes are passed on straight from the patch
+				chunk = MIN(len, (size_t)patch->extra_len);
+				if ((ret = patch->on_output(patch->ctx, data, chunk)) != 0)
+				{
+					patch->state = BSPATCH_STATE_ERROR;
+					return ret;
+				}
+				patch->new_pos += chunk;
+				patch->extra_len -= chunk;
+				data += chunk;
+				len -= chunk;
+				bspatch_settle(patch);
+				break;
+
+			case BSPATCH_STATE_DONE:
+				// Nothing may follow the last block
+				patch->state = BSPATCH_STATE_ERROR;
+				return -1;
+
+			case BSPATCH_STATE_ERROR:
+			default:
+				return -1;
+		}
+	}
+
+	return (patch->state == BSPATCH_STATE_ERROR) ? -1 : 0;
+}
+
+int bspatch_finish(bspatch_t *patch)
+{
+	return (patch->state == BSPATCH_STATE_DONE) ? 0 : -1;
+}
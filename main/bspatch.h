@@ -0,0 +1,97 @@
+/*
+ * bspatch.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef MAIN_BSPATCH_H_
+#define MAIN_BSPATCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Size of the buffers used to read the old image and to rebuild the new one
+#define BSPATCH_BLOCK_SIZE		256
+
+/**
+ * Callback reading the old image the patch was created against.
+ * @param ctx user context passed to bspatch_init.
+ * @param offset offset in the old image.
+ * @param buf destination buffer.
+ * @param len number of bytes to read.
+ * @return 0 on success, any other value aborts.
+ */
+typedef int (*bspatch_read_cb_t)(void *ctx, size_t offset, uint8_t *buf, size_t len);
+
+/**
+ * Callback receiving the rebuilt image.
+ * @param ctx user context passed to bspatch_init.
+ * @param data bytes of the new image, only valid for the duration of the call.
+ * @param len number of bytes in data.
+ * @return 0 on success, any other value aborts.
+ */
+typedef int (*bspatch_output_cb_t)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * Patch applier states
+ */
+typedef enum bspatch_state
+{
+	BSPATCH_STATE_HEADER = 0,
+	BSPATCH_STATE_CONTROL,
+	BSPATCH_STATE_DIFF,
+	BSPATCH_STATE_EXTRA,
+	BSPATCH_STATE_DONE,
+	BSPATCH_STATE_ERROR,
+} bspatch_state_e;
+
+/**
+ * Streaming applier for uncompressed bsdiff patches in the ENDSLEY/BSDIFF43 stream format.
+ * Memory use is bounded by BSPATCH_BLOCK_SIZE, the old image is read on demand.
+ */
+typedef struct bspatch
+{
+	bspatch_state_e state;
+	uint8_t field[24];					///> Header or control block being collected
+	size_t field_len;
+	int64_t new_size;
+	int64_t new_pos;
+	int64_t old_pos;
+	size_t old_size;
+	int64_t diff_len;					///> Bytes left in the current diff block
+	int64_t extra_len;					///> Bytes left in the current extra block
+	int64_t seek;						///> Old image adjustment after the extra block
+	bspatch_read_cb_t read_old;
+	bspatch_output_cb_t on_output;
+	void *ctx;
+	uint8_t old_block[BSPATCH_BLOCK_SIZE];
+	uint8_t new_block[BSPATCH_BLOCK_SIZE];
+} bspatch_t;
+
+/**
+ * Initializes the patch applier.
+ * @param patch patch applier instance.
+ * @param old_size size of the old image, bytes past its end read as zero.
+ * @param read_old callback reading the old image.
+ * @param on_output callback receiving the new image.
+ * @param ctx user context passed to the callbacks.
+ */
+void bspatch_init(bspatch_t *patch, size_t old_size, bspatch_read_cb_t read_old, bspatch_output_cb_t on_output, void *ctx);
+
+/**
+ * Applies the next chunk of the patch, chunks may be split at any byte.
+ * @param patch patch applier instance.
+ * @param data patch bytes.
+ * @param len number of bytes in data.
+ * @return 0 on success, -1 if the patch is malformed, otherwise the value returned by a callback.
+ */
+int bspatch_feed(bspatch_t *patch, const uint8_t *data, size_t len);
+
+/**
+ * Checks that the whole new image was rebuilt at the end of the patch.
+ * @param patch patch applier instance.
+ * @return 0 on success, -1 if the patch was truncated or malformed.
+ */
+int bspatch_finish(bspatch_t *patch);
+
+#endif /* MAIN_BSPATCH_H_ */
@@ -0,0 +1,353 @@
+/*
+ * dht.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Protocol, the same for DHT11 and DHT22:
+ * 1. MCU sends the start signal: LOW for a model dependent time, then releases the line
+ * 2. The sensor responds with LOW for 80us, then HIGH for 80us
+ * 3. The sensor sends 40 bits (5 bytes): humidity, temperature, checksum (sum of bytes 0-3)
+ * 4. Each bit starts with 50us LOW, then 26-28us HIGH for a '0' or 70us HIGH for a '1'
+ *
+ * A read runs as a state machine, so the reading task blocks instead of spinning:
+ * the start signal is timed by an esp_timer, the response and the data bits are captured
+ * by the RMT receiver and the frame is decoded by dht_decode.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "driver/rmt_rx.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#include "dht.h"
+#include "dht_decode.h"
+
+// Tag used for ESP serial console messages
+static const char TAG[] = "dht";
+
+// RMT capture settings
+#define DHT_RMT_RESOLUTION_HZ		1000000		// 1 tick = 1 us
+#define DHT_RMT_SYMBOLS				48			// One RMT memory block, response, 40 bits and the closing low take 42
+#define DHT_RMT_MIN_NS				1000		// Shorter glitches are ignored
+#define DHT_RMT_MAX_NS				200000		// The frame ends once the line idles this long
+#define DHT_RMT_TIMEOUT_MS			20			// A whole frame takes about 5 ms
+
+/*
+ * Model traits: start signal, bit timing and scaling of the frame
+ */
+#if DHT_MODEL == DHT_MODEL_DHT11
+
+#define DHT_NAME					"DHT11"
+#define DHT_START_LOW_US			20000		// At least 18 ms
+#define DHT_BIT_THRESHOLD_US		50			// Between the 26-28 us high of a '0' and the 70 us high of a '1'
+#define DHT_PULSE_MAX_US			110			// The 50-54 us bit lows and the highs of DHT11 parts vary widely
+
+/**
+ * Scales a DHT11 frame: integer and tenths bytes, the tenths are 0 on older parts.
+ */
+static inline void dht_scale(const uint8_t *data, dht_sample_t *sample)
+{
+	sample->humidity = data[0] + data[1] / 10.0f;
+	sample->temperature = data[2] + (data[3] & 0x7F) / 10.0f;
+	if (data[3] & 0x80)
+	{
+		sample->temperature = -sample->temperature;
+	}
+}
+
+#elif DHT_MODEL == DHT_MODEL_DHT22
+
+#define DHT_NAME					"DHT22"
+#define DHT_START_LOW_US			2000		// 1-10 ms
+#define DHT_BIT_THRESHOLD_US		48			// Between the 26-28 us high of a '0' and the 70 us high of a '1'
+#define DHT_PULSE_MAX_US			100			// Longest low or high time within a bit
+
+/**
+ * Scales a DHT22 frame: 16 bit values in tenths, the top bit of the temperature is its sign.
+ */
+static inline void dht_scale(const uint8_t *data, dht_sample_t *sample)
+{
+	sample->humidity = ((data[0] << 8) | data[1]) / 10.0f;
+	sample->temperature = (((data[2] & 0x7F) << 8) | data[3]) / 10.0f;
+	if (data[2] & 0x80)
+	{
+		sample->temperature = -sample->temperature;
+	}
+}
+
+#else
+#error "Unsupported DHT_MODEL"
+#endif
+
+// Bit timing handed to dht_decode
+static const dht_decode_timing_t dht_timing = {
+		.bit_threshold_us = DHT_BIT_THRESHOLD_US,
+		.pulse_max_us = DHT_PULSE_MAX_US,
+};
+
+/**
+ * Read states
+ */
+typedef enum dht_state
+{
+	DHT_STATE_IDLE = 0,
+	DHT_STATE_START_SIGNAL,				///> Line driven LOW, start timer armed
+	DHT_STATE_CAPTURE,					///> Line released, RMT capture armed
+} dht_state_e;
+
+/**
+ * Outcome of a capture, handed to the reading task through the result queue
+ */
+typedef struct dht_capture_result
+{
+	esp_err_t err;
+	size_t num_symbols;
+} dht_capture_result_t;
+
+/**
+ * Sensor instance
+ */
+struct dht
+{
+	gpio_num_t gpio_num;
+	rmt_channel_handle_t rx_channel;
+	QueueHandle_t rx_queue;				///> Capture result of the running read
+	esp_timer_handle_t start_timer;		///> Ends the start signal
+	volatile dht_state_e state;
+	rmt_symbol_word_t rx_symbols[DHT_RMT_SYMBOLS];
+};
+
+/**
+ * RMT receive done callback, ends the capture and hands the number of captured symbols to dht_read.
+ */
+static bool IRAM_ATTR dht_rx_done_callback(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *edata, void *user_ctx)
+{
+	dht_handle_t dht = user_ctx;
+	BaseType_t task_woken = pdFALSE;
+	dht_capture_result_t result = {
+			.err = ESP_OK,
+			.num_symbols = edata->num_symbols,
+	};
+
+	dht->state = DHT_STATE_IDLE;
+	xQueueSendFromISR(dht->rx_queue, &result, &task_woken);
+
+	return task_woken == pdTRUE;
+}
+
+/**
+ * Start timer callback, ends the start signal: releases the line and arms the capture of the
+ * response and the 40 bits. The capture is only armed now so the start signal does not end it.
+ */
+static void dht_start_timer_callback(void *arg)
+{
+	dht_handle_t dht = arg;
+	rmt_receive_config_t receive_config = {
+			.signal_range_min_ns = DHT_RMT_MIN_NS,
+			.signal_range_max_ns = DHT_RMT_MAX_NS,
+	};
+
+	gpio_set_level(dht->gpio_num, 1);
+
+	dht->state = DHT_STATE_CAPTURE;
+	dht_capture_result_t result = {
+			.err = rmt_receive(dht->rx_channel, dht->rx_symbols, sizeof(dht->rx_symbols), &receive_config),
+			.num_symbols = 0,
+	};
+	if (result.err != ESP_OK)
+	{
+		dht->state = DHT_STATE_IDLE;
+		xQueueSend(dht->rx_queue, &result, 0);
+	}
+}
+
+/**
+ * Converts captured RMT symbols into low/high pulse pairs for dht_decode.
+ * @return number of pulses.
+ */
+static size_t dht_symbols_to_pulses(const rmt_symbol_word_t *symbols, size_t num_symbols, dht_pulse_t *pulses)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < num_symbols * 2; i++)
+	{
+		const rmt_symbol_word_t *symbol = &symbols[i / 2];
+		unsigned level = (i % 2) ? symbol->level1 : symbol->level0;
+		unsigned duration = (i % 2) ? symbol->duration1 : symbol->duration0;
+
+		// A duration of 0 marks the end of the capture, the high time of the last pulse stays 0
+		if (duration == 0)
+		{
+			break;
+		}
+
+		if (level == 0)
+		{
+			pulses[count].low_us = duration;
+			pulses[count].high_us = 0;
+			count++;
+		}
+		else if (count > 0)
+		{
+			pulses[count - 1].high_us = duration;
+		}
+	}
+
+	return count;
+}
+
+esp_err_t dht_create(gpio_num_t gpio_num, dht_handle_t *handle)
+{
+	esp_err_t err;
+
+	dht_handle_t dht = calloc(1, sizeof(struct dht));
+	if (dht == NULL)
+	{
+		return ESP_ERR_NO_MEM;
+	}
+	dht->gpio_num = gpio_num;
+
+	if ((dht->rx_queue = xQueueCreate(1, sizeof(dht_capture_result_t))) == NULL)
+	{
+		dht_delete(dht);
+		return ESP_ERR_NO_MEM;
+	}
+
+	const esp_timer_create_args_t timer_args = {
+			.callback = &dht_start_timer_callback,
+			.arg = dht,
+			.dispatch_method = ESP_TIMER_TASK,
+			.name = "dht_start"
+	};
+	if ((err = esp_timer_create(&timer_args, &dht->start_timer)) != ESP_OK)
+	{
+		dht_delete(dht);
+		return err;
+	}
+
+	rmt_rx_channel_config_t rx_config = {
+			.gpio_num = gpio_num,
+			.clk_src = RMT_CLK_SRC_DEFAULT,
+			.resolution_hz = DHT_RMT_RESOLUTION_HZ,
+			.mem_block_symbols = DHT_RMT_SYMBOLS,
+	};
+	if ((err = rmt_new_rx_channel(&rx_config, &dht->rx_channel)) != ESP_OK)
+	{
+		ESP_LOGE(TAG, "dht_create: Failed to create RMT channel for GPIO %d: %s", gpio_num, esp_err_to_name(err));
+		dht_delete(dht);
+		return err;
+	}
+
+	rmt_rx_event_callbacks_t callbacks = {
+			.on_recv_done = dht_rx_done_callback,
+	};
+	if ((err = rmt_rx_register_event_callbacks(dht->rx_channel, &callbacks, dht)) != ESP_OK ||
+		(err = rmt_enable(dht->rx_channel)) != ESP_OK)
+	{
+		dht_delete(dht);
+		return err;
+	}
+
+	ESP_LOGI(TAG, "dht_create: " DHT_NAME " on GPIO %d", gpio_num);
+
+	*handle = dht;
+
+	return ESP_OK;
+}
+
+void dht_delete(dht_handle_t dht)
+{
+	if (dht == NULL)
+	{
+		return;
+	}
+
+	if (dht->rx_channel != NULL)
+	{
+		rmt_disable(dht->rx_channel);
+		rmt_del_channel(dht->rx_channel);
+	}
+	if (dht->start_timer != NULL)
+	{
+		esp_timer_stop(dht->start_timer);
+		esp_timer_delete(dht->start_timer);
+	}
+	if (dht->rx_queue != NULL)
+	{
+		vQueueDelete(dht->rx_queue);
+	}
+	free(dht);
+}
+
+esp_err_t dht_read(dht_handle_t dht, dht_sample_t *sample)
+{
+	uint8_t data[DHT_DECODE_FRAME_BYTES];
+	dht_pulse_t pulses[DHT_RMT_SYMBOLS];
+	dht_capture_result_t result;
+	esp_err_t err;
+
+	if (dht == NULL || sample == NULL)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (dht->state != DHT_STATE_IDLE)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	// Send the start signal, the start timer takes the read on from here.
+	// Open drain output, the RMT receiver keeps seeing the line through the input
+	xQueueReset(dht->rx_queue);
+	gpio_set_direction(dht->gpio_num, GPIO_MODE_INPUT_OUTPUT_OD);
+	gpio_set_level(dht->gpio_num, 0);
+	dht->state = DHT_STATE_START_SIGNAL;
+	if ((err = esp_timer_start_once(dht->start_timer, DHT_START_LOW_US)) != ESP_OK)
+	{
+		gpio_set_level(dht->gpio_num, 1);
+		dht->state = DHT_STATE_IDLE;
+		return err;
+	}
+
+	// Block until the capture is done
+	if (xQueueReceive(dht->rx_queue, &result, pdMS_TO_TICKS(DHT_START_LOW_US / 1000 + DHT_RMT_TIMEOUT_MS)) != pdTRUE)
+	{
+		// No response, restarting the channel cancels the pending capture
+		esp_timer_stop(dht->start_timer);
+		rmt_disable(dht->rx_channel);
+		rmt_enable(dht->rx_channel);
+		gpio_set_level(dht->gpio_num, 1);
+		dht->state = DHT_STATE_IDLE;
+		ESP_LOGE(TAG, "dht_read: GPIO %d: Timeout waiting for response", dht->gpio_num);
+		return ESP_ERR_TIMEOUT;
+	}
+	if (result.err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "dht_read: GPIO %d: Failed to start capture: %s", dht->gpio_num, esp_err_to_name(result.err));
+		return result.err;
+	}
+
+	switch (dht_decode(pulses, dht_symbols_to_pulses(dht->rx_symbols, result.num_symbols, pulses), &dht_timing, data))
+	{
+		case DHT_DECODE_OK:
+			break;
+
+		case DHT_DECODE_CHECKSUM:
+			ESP_LOGE(TAG, "dht_read: GPIO %d: Checksum error: calculated 0x%02X, received 0x%02X", dht->gpio_num,
+					(data[0] + data[1] + data[2] + data[3]) & 0xFF, data[4]);
+			return ESP_ERR_INVALID_CRC;
+
+		default:
+			ESP_LOGE(TAG, "dht_read: GPIO %d: Malformed frame, %u symbols captured", dht->gpio_num, (unsigned)result.num_symbols);
+			return ESP_ERR_INVALID_RESPONSE;
+	}
+
+	dht_scale(data, sample);
+	sample->timestamp_us = esp_timer_get_time();
+
+	return ESP_OK;
+}
@@ -0,0 +1,74 @@
+/*
+ * dht.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Driver for DHT11 and DHT22 (AM2302) temperature and humidity sensors.
+ * Both speak the same single wire protocol, the model only changes the start signal and how the frame
+ * is scaled. It is picked at compile time with DHT_MODEL.
+ */
+
+#ifndef MAIN_DHT_H_
+#define MAIN_DHT_H_
+
+#include <stdint.h>
+
+#include "driver/gpio.h"
+#include "esp_err.h"
+
+// Supported sensor models
+#define DHT_MODEL_DHT11				11
+#define DHT_MODEL_DHT22				22
+
+// Sensor model the driver is built for
+#ifndef DHT_MODEL
+#define DHT_MODEL					DHT_MODEL_DHT11
+#endif
+
+// Shortest time between two reads of the same sensor
+#if DHT_MODEL == DHT_MODEL_DHT11
+#define DHT_MIN_INTERVAL_MS			1000
+#else
+#define DHT_MIN_INTERVAL_MS			2000
+#endif
+
+/**
+ * Sensor instance, created by dht_create
+ */
+typedef struct dht *dht_handle_t;
+
+/**
+ * Reading of a sensor
+ */
+typedef struct dht_sample
+{
+	float temperature;					///> Temperature in Celsius
+	float humidity;						///> Relative humidity in percent
+	int64_t timestamp_us;				///> esp_timer_get_time() when the frame was captured
+} dht_sample_t;
+
+/**
+ * Creates a sensor instance on a GPIO. Every instance holds an RMT receive channel.
+ * @param gpio_num GPIO the data line of the sensor is connected to.
+ * @param handle set to the new instance.
+ * @return ESP_OK, otherwise an error code.
+ */
+esp_err_t dht_create(gpio_num_t gpio_num, dht_handle_t *handle);
+
+/**
+ * Releases a sensor instance.
+ * @param handle instance created by dht_create.
+ */
+void dht_delete(dht_handle_t handle);
+
+/**
+ * Reads a sensor. The calling task blocks, it does not spin, for the ~25 ms the read takes.
+ * Different instances can be read from different tasks at the same time.
+ * @param handle instance created by dht_create.
+ * @param sample set to the reading.
+ * @return ESP_OK, ESP_ERR_TIMEOUT if the sensor did not respond, ESP_ERR_INVALID_CRC on a checksum error,
+ * ESP_ERR_INVALID_RESPONSE on a malformed frame, otherwise an error code.
+ */
+esp_err_t dht_read(dht_handle_t handle, dht_sample_t *sample);
+
+#endif /* MAIN_DHT_H_ */
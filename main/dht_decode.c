@@ -0,0 +1,47 @@
+/*
+ * dht_decode.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Decoder for the 40 bit frame of DHT11/DHT22 sensors. Every bit is a ~50 us low followed by
+ * a 26-28 us high for a '0' or a 70 us high for a '1'.
+ */
+
+#include <string.h>
+
+#include "dht_decode.h"
+
+dht_decode_result_e dht_decode(const dht_pulse_t *pulses, size_t count, const dht_decode_timing_t *timing, uint8_t data[DHT_DECODE_FRAME_BYTES])
+{
+	memset(data, 0, DHT_DECODE_FRAME_BYTES);
+
+	// The last pulse has no end to its high time, it is only the low closing the last bit
+	while (count > 0 && pulses[count - 1].high_us == 0)
+	{
+		count--;
+	}
+	if (count < DHT_DECODE_FRAME_BITS)
+	{
+		return DHT_DECODE_SHORT_FRAME;
+	}
+	pulses += count - DHT_DECODE_FRAME_BITS;
+
+	for (int i = 0; i < DHT_DECODE_FRAME_BITS; i++)
+	{
+		if (pulses[i].low_us > timing->pulse_max_us || pulses[i].high_us > timing->pulse_max_us)
+		{
+			return DHT_DECODE_BAD_TIMING;
+		}
+		if (pulses[i].high_us > timing->bit_threshold_us)
+		{
+			data[i / 8] |= 1 << (7 - (i % 8));
+		}
+	}
+
+	if (((data[0] + data[1] + data[2] + data[3]) & 0xFF) != data[4])
+	{
+		return DHT_DECODE_CHECKSUM;
+	}
+
+	return DHT_DECODE_OK;
+}
@@ -0,0 +1,59 @@
+/*
+ * dht_decode.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef MAIN_DHT_DECODE_H_
+#define MAIN_DHT_DECODE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// DHT frame settings
+#define DHT_DECODE_FRAME_BITS		40			// 2 bytes humidity, 2 bytes temperature, 1 byte checksum
+#define DHT_DECODE_FRAME_BYTES		5
+
+/**
+ * Bit timing of a sensor model
+ */
+typedef struct dht_decode_timing
+{
+	uint16_t bit_threshold_us;			///> Longest high time of a '0', longer highs are a '1'
+	uint16_t pulse_max_us;				///> Longest low or high time within a bit
+} dht_decode_timing_t;
+
+/**
+ * One captured pulse of the data line: the time it was held low, then the time it was high.
+ * The high time of the final pulse of a capture is 0, it lasts until the line goes idle.
+ */
+typedef struct dht_pulse
+{
+	uint16_t low_us;
+	uint16_t high_us;
+} dht_pulse_t;
+
+/**
+ * Decoder results
+ */
+typedef enum dht_decode_result
+{
+	DHT_DECODE_OK = 0,
+	DHT_DECODE_SHORT_FRAME,				///> Fewer than 40 bits were captured
+	DHT_DECODE_BAD_TIMING,				///> A pulse is longer than a bit can be
+	DHT_DECODE_CHECKSUM,				///> The checksum byte does not match the data
+} dht_decode_result_e;
+
+/**
+ * Decodes a DHT frame from captured pulse durations.
+ * The 40 data bits are the last 40 whole pulses, so the sensor's response pulse and anything captured before it are skipped.
+ * Has no hardware dependencies, so it can be run on the host against recorded pulse traces.
+ * @param pulses captured pulses, oldest first.
+ * @param count number of pulses.
+ * @param timing bit timing of the sensor model.
+ * @param data set to the 5 frame bytes, most significant bit first.
+ * @return DHT_DECODE_OK if data holds a frame with a valid checksum, otherwise the reason it does not.
+ */
+dht_decode_result_e dht_decode(const dht_pulse_t *pulses, size_t count, const dht_decode_timing_t *timing, uint8_t data[DHT_DECODE_FRAME_BYTES]);
+
+#endif /* MAIN_DHT_DECODE_H_ */
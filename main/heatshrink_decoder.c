@@ -0,0 +1,157 @@
+/*
+ * heatshrink_decoder.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Streaming decoder for the heatshrink LZSS format (https://github.com/atomicobject/heatshrink).
+ *
+ * The stream is a sequence of MSB first bit fields:
+ *   1 <8 bit literal>
+ *   0 <WINDOW_BITS index - 1> <LOOKAHEAD_BITS count - 1>, copies count bytes from index bytes back
+ * The window starts out zeroed, the last byte is padded with zero bits.
+ */
+
+#include <string.h>
+
+#include "heatshrink_decoder.h"
+
+#define HEATSHRINK_WINDOW_MASK		(HEATSHRINK_WINDOW_SIZE - 1)
+
+/**
+ * Passes every decoded byte not yet reported on to the callback, straight from the window.
+ * @return 0 on success, otherwise the value returned by the callback.
+ */
+static int heatshrink_decoder_flush(heatshrink_decoder_t *decoder)
+{
+	while (decoder->flushed != decoder->head)
+	{
+		size_t start = decoder->flushed & HEATSHRINK_WINDOW_MASK;
+		size_t len = decoder->head - decoder->flushed;
+
+		// The pending bytes may wrap around the end of the window
+		if (start + len > HEATSHRINK_WINDOW_SIZE)
+		{
+			len = HEATSHRINK_WINDOW_SIZE - start;
+		}
+
+		int ret = decoder->on_output(decoder->ctx, &decoder->window[start], len);
+		if (ret != 0)
+		{
+			return ret;
+		}
+		decoder->flushed += len;
+	}
+
+	return 0;
+}
+
+/**
+ * Appends a decoded byte to the window, flushing first if it would overwrite a byte not reported yet.
+ * @return 0 on success, otherwise the value returned by the callback.
+ */
+static inline int heatshrink_decoder_put(heatshrink_decoder_t *decoder, uint8_t c)
+{
+	if (decoder->head - decoder->flushed == HEATSHRINK_WINDOW_SIZE)
+	{
+		int ret = heatshrink_decoder_flush(decoder);
+		if (ret != 0)
+		{
+			return ret;
+		}
+	}
+
+	decoder->window[decoder->head++ & HEATSHRINK_WINDOW_MASK] = c;
+
+	return 0;
+}
+
+/**
+ * Takes the next bit field from the bit buffer, the caller checks that enough bits are available.
+ */
+static inline uint16_t heatshrink_decoder_take(heatshrink_decoder_t *decoder, uint8_t bits)
+{
+	decoder->bit_count -= bits;
+
+	return (decoder->bit_buf >> decoder->bit_count) & ((1u << bits) - 1);
+}
+
+void heatshrink_decoder_init(heatshrink_decoder_t *decoder, heatshrink_output_cb_t on_output, void *ctx)
+{
+	memset(decoder, 0, sizeof(*decoder));
+	decoder->state = HEATSHRINK_STATE_TAG_BIT;
+	decoder->on_output = on_output;
+	decoder->ctx = ctx;
+}
+
+int heatshrink_decoder_feed(heatshrink_decoder_t *decoder, const uint8_t *data, size_t len)
+{
+	int ret;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		decoder->bit_buf = (decoder->bit_buf << 8) | data[i];
+		decoder->bit_count += 8;
+
+		// Decode every field which is complete now
+		for (;;)
+		{
+			if (decoder->state == HEATSHRINK_STATE_TAG_BIT)
+			{
+				if (decoder->bit_count < 1)
+				{
+					break;
+				}
+				decoder->state = heatshrink_decoder_take(decoder, 1) ? HEATSHRINK_STATE_LITERAL : HEATSHRINK_STATE_BACKREF_INDEX;
+			}
+			else if (decoder->state == HEATSHRINK_STATE_LITERAL)
+			{
+				if (decoder->bit_count < 8)
+				{
+					break;
+				}
+				if ((ret = heatshrink_decoder_put(decoder, heatshrink_decoder_take(decoder, 8))) != 0)
+				{
+					return ret;
+				}
+				decoder->state = HEATSHRINK_STATE_TAG_BIT;
+			}
+			else if (decoder->state == HEATSHRINK_STATE_BACKREF_INDEX)
+			{
+				if (decoder->bit_count < HEATSHRINK_WINDOW_BITS)
+				{
+					break;
+				}
+				decoder->backref_index = heatshrink_decoder_take(decoder, HEATSHRINK_WINDOW_BITS) + 1;
+				decoder->state = HEATSHRINK_STATE_BACKREF_COUNT;
+			}
+			else
+			{
+				if (decoder->bit_count < HEATSHRINK_LOOKAHEAD_BITS)
+				{
+					break;
+				}
+				uint16_t count = heatshrink_decoder_take(decoder, HEATSHRINK_LOOKAHEAD_BITS) + 1;
+				for (uint16_t n = 0; n < count; n++)
+				{
+					uint8_t c = decoder->window[(decoder->head - decoder->backref_index) & HEATSHRINK_WINDOW_MASK];
+					if ((ret = heatshrink_decoder_put(decoder, c)) != 0)
+					{
+						return ret;
+					}
+				}
+				decoder->state = HEATSHRINK_STATE_TAG_BIT;
+			}
+		}
+	}
+
+	return heatshrink_decoder_flush(decoder);
+}
+
+int heatshrink_decoder_finish(heatshrink_decoder_t *decoder)
+{
+	// Leftover bits are the zero padding of the last byte
+	decoder->bit_count = 0;
+	decoder->state = HEATSHRINK_STATE_TAG_BIT;
+
+	return heatshrink_decoder_flush(decoder);
+}
@@ -0,0 +1,81 @@
+/*
+ * heatshrink_decoder.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef MAIN_HEATSHRINK_DECODER_H_
+#define MAIN_HEATSHRINK_DECODER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Stream parameters, must match the encoder e.g. heatshrink -e -w 11 -l 4 firmware.bin firmware.bin.hs
+#define HEATSHRINK_WINDOW_BITS		11			// 2 KB window
+#define HEATSHRINK_LOOKAHEAD_BITS	4
+
+#define HEATSHRINK_WINDOW_SIZE		(1 << HEATSHRINK_WINDOW_BITS)
+
+/**
+ * Callback receiving decompressed bytes.
+ * @param ctx user context passed to heatshrink_decoder_init.
+ * @param data decompressed bytes, only valid for the duration of the call.
+ * @param len number of bytes in data.
+ * @return 0 to continue decoding, any other value aborts.
+ */
+typedef int (*heatshrink_output_cb_t)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * Decoder states
+ */
+typedef enum heatshrink_decoder_state
+{
+	HEATSHRINK_STATE_TAG_BIT = 0,
+	HEATSHRINK_STATE_LITERAL,
+	HEATSHRINK_STATE_BACKREF_INDEX,
+	HEATSHRINK_STATE_BACKREF_COUNT,
+} heatshrink_decoder_state_e;
+
+/**
+ * Streaming heatshrink (LZSS) decoder.
+ * Memory use is fixed: the window doubles as the output buffer, so decompressed bytes are passed on
+ * straight from it and nothing else is allocated.
+ */
+typedef struct heatshrink_decoder
+{
+	heatshrink_decoder_state_e state;
+	uint32_t bit_buf;						///> Input bits not consumed yet
+	uint8_t bit_count;
+	uint16_t backref_index;
+	uint32_t head;							///> Number of bytes decoded so far
+	uint32_t flushed;						///> Number of bytes passed on to the callback
+	heatshrink_output_cb_t on_output;
+	void *ctx;
+	uint8_t window[HEATSHRINK_WINDOW_SIZE];
+} heatshrink_decoder_t;
+
+/**
+ * Initializes the decoder.
+ * @param decoder decoder instance.
+ * @param on_output callback receiving the decompressed bytes.
+ * @param ctx user context passed to on_output.
+ */
+void heatshrink_decoder_init(heatshrink_decoder_t *decoder, heatshrink_output_cb_t on_output, void *ctx);
+
+/**
+ * Decodes the next chunk of the compressed stream, chunks may be split at any byte.
+ * @param decoder decoder instance.
+ * @param data compressed bytes.
+ * @param len number of bytes in data.
+ * @return 0 on success, otherwise the value returned by the callback.
+ */
+int heatshrink_decoder_feed(heatshrink_decoder_t *decoder, const uint8_t *data, size_t len);
+
+/**
+ * Passes the remaining decompressed bytes on to the callback at the end of the stream.
+ * @param decoder decoder instance.
+ * @return 0 on success, otherwise the value returned by the callback.
+ */
+int heatshrink_decoder_finish(heatshrink_decoder_t *decoder);
+
+#endif /* MAIN_HEATSHRINK_DECODER_H_ */
@@ -5,20 +5,47 @@
  *      Author: kjagu
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "esp_ota_ops.h"
 #include "esp_timer.h"
+#include "freertos/semphr.h"
 #include "sys/param.h"
 
-#include "dht11.h"
 #include "http_server.h"
+#include "multipart_parser.h"
+#include "ota_digest.h"
+#include "ota_stats.h"
+#include "ota_writer.h"
+#include "sensor_manager.h"
 #include "tasks_common.h"
+#include "webpage_assets.h"
 #include "wifi_app.h"
 
 // Tag used for ESP serial console messages
 static const char TAG[] = "http_server";
 
+// Minimum time between two OTA progress messages to the web page
+#define HTTP_SERVER_OTA_PROGRESS_INTERVAL_US	250000
+
+// Longest time an upload may send nothing before it is cancelled, a stalled client must not hold
+// the OTA session and an async worker for good
+#define HTTP_SERVER_OTA_STALL_TIMEOUT_US		30000000
+
+// Longest dhtSensor.json parts: the top level fields, and the entry of a sensor with a name of up to 24 characters
+#define HTTP_SERVER_DHT_SENSOR_JSON_HEAD		64
+#define HTTP_SERVER_DHT_SENSOR_JSON_ENTRY		192
+
+// Size of a cached JSON response, dhtSensor.json lists every sensor
+#define HTTP_SERVER_JSON_CACHE_SIZE				(HTTP_SERVER_DHT_SENSOR_JSON_HEAD + SENSOR_MANAGER_MAX_SENSORS * HTTP_SERVER_DHT_SENSOR_JSON_ENTRY)
+
+// Longest time a dhtSensor.json long-poll is held on an async worker
+#define HTTP_SERVER_LONG_POLL_TIMEOUT_MS		20000
+
 // Firmware update status
 static int g_fw_update_status = OTA_UPDATE_PENDING;
 
@@ -31,6 +58,44 @@ static TaskHandle_t task_http_server_monitor = NULL;
 // Queue handle used to manipulate the main queue of events
 static QueueHandle_t http_server_monitor_queue_handle;
 
+/**
+ * Serialized JSON response, rebuilt only when the data it is made from changes
+ */
+typedef struct http_server_json_cache
+{
+	bool valid;
+	uint32_t version;					///> Version of the data body was built from
+	size_t len;
+	char body[HTTP_SERVER_JSON_CACHE_SIZE];
+} http_server_json_cache_t;
+
+/**
+ * Builds the body of a cached JSON response.
+ * @param buf destination.
+ * @param len size of buf.
+ * @return length of the body, len or more if it was truncated.
+ */
+typedef int (*http_server_json_build_t)(char *buf, size_t len);
+
+// Cached dhtSensor.json and OTAstatus responses, shared by the HTTP server task and the async workers
+static http_server_json_cache_t http_server_dht_sensor_cache;
+static http_server_json_cache_t http_server_OTA_status_cache;
+static SemaphoreHandle_t http_server_json_cache_mutex = NULL;
+
+/**
+ * Request handed over to an async worker
+ */
+typedef struct http_server_async_req
+{
+	httpd_req_t *req;
+	esp_err_t (*handler)(httpd_req_t *req);
+} http_server_async_req_t;
+
+// Async worker task handles, the queue of requests for them and the number of idle workers
+static TaskHandle_t http_server_async_workers[HTTP_SERVER_ASYNC_WORKER_COUNT];
+static QueueHandle_t http_server_async_queue = NULL;
+static SemaphoreHandle_t http_server_async_idle = NULL;
+
 /**
  * ESP32 timer configuration passed to esp_timer_create.
  */
@@ -42,18 +107,6 @@ const esp_timer_create_args_t fw_update_reset_args = {
 };
 esp_timer_handle_t fw_update_reset;
 
-// Embedded files: JQuery, index.html, app.css, app.js and favicon.ico files
-extern const uint8_t jquery_3_3_1_min_js_start[]	asm("_binary_jquery_3_3_1_min_js_start");
-extern const uint8_t jquery_3_3_1_min_js_end[]		asm("_binary_jquery_3_3_1_min_js_end");
-extern const uint8_t index_html_start[]				asm("_binary_index_html_start");
-extern const uint8_t index_html_end[]				asm("_binary_index_html_end");
-extern const uint8_t app_css_start[]				asm("_binary_app_css_start");
-extern const uint8_t app_css_end[]					asm("_binary_app_css_end");
-extern const uint8_t app_js_start[]					asm("_binary_app_js_start");
-extern const uint8_t app_js_end[]					asm("_binary_app_js_end");
-extern const uint8_t favicon_ico_start[]			asm("_binary_favicon_ico_start");
-extern const uint8_t favicon_ico_end[]				asm("_binary_favicon_ico_end");
-
 /**
  * Checks the g_fw_update_status and creates the fw_update_reset timer if g_fw_update_status is true.
  */
@@ -123,214 +176,961 @@ static void http_server_monitor(void *parameter)
 }
 
 /**
- * Jquery get handler is requested when accessing the web page.
- * @param req HTTP request for which the uri needs to be handled.
- * @return ESP_OK
+ * Checks whether the calling task is one of the async workers.
+ * @return true on an async worker, false on the HTTP server task.
  */
-static esp_err_t http_server_jquery_handler(httpd_req_t *req)
+static bool http_server_is_async_worker(void)
 {
-	ESP_LOGI(TAG, "Jquery requested");
+	TaskHandle_t current = xTaskGetCurrentTaskHandle();
 
-	httpd_resp_set_type(req, "application/javascript");
-	httpd_resp_send(req, (const char *)jquery_3_3_1_min_js_start, jquery_3_3_1_min_js_end - jquery_3_3_1_min_js_start);
+	for (int i = 0; i < HTTP_SERVER_ASYNC_WORKER_COUNT; i++)
+	{
+		if (http_server_async_workers[i] == current)
+		{
+			return true;
+		}
+	}
 
-	return ESP_OK;
+	return false;
 }
 
 /**
- * Sends the index.html page.
- * @param req HTTP request for which the uri needs to be handled.
- * @return ESP_OK
+ * Hands a long running request over to an idle async worker, so the HTTP server task is free for other requests
+ * while it runs. Responds with 503 if every worker is busy.
+ * @param req HTTP request to hand over.
+ * @param handler handler to run for the request on the worker.
+ * @return ESP_OK if a worker took the request, otherwise ESP_FAIL.
  */
-static esp_err_t http_server_index_html_handler(httpd_req_t *req)
+static esp_err_t http_server_queue_async(httpd_req_t *req, esp_err_t (*handler)(httpd_req_t *req))
 {
-	ESP_LOGI(TAG, "index.html requested");
+	http_server_async_req_t async_req = {
+			.handler = handler,
+	};
 
-	httpd_resp_set_type(req, "text/html");
-	httpd_resp_send(req, (const char *)index_html_start, index_html_end - index_html_start);
+	// Queued requests would wait behind a running upload, so a request is only handed over to an idle worker
+	if (xSemaphoreTake(http_server_async_idle, 0) != pdTRUE)
+	{
+		ESP_LOGI(TAG, "http_server_queue_async: All workers busy");
+		httpd_resp_set_status(req, "503 Service Unavailable");
+		httpd_resp_sendstr(req, "Server busy");
+		return ESP_FAIL;
+	}
+
+	// Copies the request, the connection stays with the worker until httpd_req_async_handler_complete
+	if (httpd_req_async_handler_begin(req, &async_req.req) != ESP_OK)
+	{
+		xSemaphoreGive(http_server_async_idle);
+		httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+		return ESP_FAIL;
+	}
+
+	xQueueSend(http_server_async_queue, &async_req, portMAX_DELAY);
 
 	return ESP_OK;
 }
 
 /**
- * app.css get handler is requested when accessing the web page.
- * @param req HTTP request for which the uri needs to be handled.
- * @return ESP_OK
+ * Async worker task, runs the requests handed over by http_server_queue_async.
+ * @param pvParameters parameter which can be passed to the task.
  */
-static esp_err_t http_server_app_css_handler(httpd_req_t *req)
+static void http_server_async_worker(void *parameter)
 {
-	ESP_LOGI(TAG, "app.css requested");
+	http_server_async_req_t async_req;
 
-	httpd_resp_set_type(req, "text/css");
-	httpd_resp_send(req, (const char *)app_css_start, app_css_end - app_css_start);
+	for (;;)
+	{
+		xSemaphoreGive(http_server_async_idle);
+		xQueueReceive(http_server_async_queue, &async_req, portMAX_DELAY);
 
-	return ESP_OK;
+		ESP_LOGI(TAG, "http_server_async_worker: Running %s", async_req.req->uri);
+		async_req.handler(async_req.req);
+		httpd_req_async_handler_complete(async_req.req);
+	}
 }
 
 /**
- * app.js get handler is requested when accessing the web page.
- * @param req HTTP request for which the uri needs to be handled.
- * @return ESP_OK
+ * Sends a text message to every WebSocket client, i.e. every web page listening on /ota/ws.
+ * Queued by http_server_ws_broadcast, it runs on the httpd task which owns the sessions, so clients cannot come and go meanwhile.
+ * @param arg message allocated by http_server_ws_broadcast, freed once sent.
  */
-static esp_err_t http_server_app_js_handler(httpd_req_t *req)
+static void http_server_ws_broadcast_work(void *arg)
 {
-	ESP_LOGI(TAG, "app.js requested");
+	char *message = arg;
+	int client_fds[CONFIG_LWIP_MAX_SOCKETS];
+	size_t clients = sizeof(client_fds) / sizeof(client_fds[0]);
+	httpd_ws_frame_t frame = {
+			.final = true,
+			.type = HTTPD_WS_TYPE_TEXT,
+			.payload = (uint8_t *)message,
+			.len = strlen(message),
+	};
+
+	if (httpd_get_client_list(http_server_handle, &clients, client_fds) == ESP_OK)
+	{
+		for (size_t i = 0; i < clients; i++)
+		{
+			if (httpd_ws_get_fd_info(http_server_handle, client_fds[i]) == HTTPD_WS_CLIENT_WEBSOCKET)
+			{
+				httpd_ws_send_frame_async(http_server_handle, client_fds[i], &frame);
+			}
+		}
+	}
 
-	httpd_resp_set_type(req, "application/javascript");
-	httpd_resp_send(req, (const char *)app_js_start, app_js_end - app_js_start);
+	free(message);
+}
 
-	return ESP_OK;
+/**
+ * Sends a text message to every WebSocket client. The message is copied and sent from the httpd task,
+ * so the calling task, e.g. an async worker receiving an upload, never touches the sessions.
+ * @param message text to send.
+ */
+static void http_server_ws_broadcast(const char *message)
+{
+	char *copy;
+
+	if (http_server_handle == NULL || (copy = strdup(message)) == NULL)
+	{
+		return;
+	}
+
+	if (httpd_queue_work(http_server_handle, http_server_ws_broadcast_work, copy) != ESP_OK)
+	{
+		free(copy);
+	}
+}
+
+/**
+ * Pushes the progress of a firmware update to the web page.
+ * Progress within a phase is sent at most every HTTP_SERVER_OTA_PROGRESS_INTERVAL_US, so it costs the upload next to nothing.
+ * @param phase "receiving" or "verifying".
+ * @param received bytes received so far.
+ * @param total bytes expected.
+ * @param phase_change true to send right away, e.g. when the phase changes.
+ */
+static void http_server_OTA_progress(const char *phase, int received, int total, bool phase_change)
+{
+	static int64_t last_progress = 0;
+	char progressJSON[100];
+	int64_t now = esp_timer_get_time();
+
+	if (!phase_change && now - last_progress < HTTP_SERVER_OTA_PROGRESS_INTERVAL_US)
+	{
+		return;
+	}
+	last_progress = now;
+
+	sprintf(progressJSON, "{\"phase\":\"%s\",\"received\":%d,\"total\":%d}", phase, received, total);
+	http_server_ws_broadcast(progressJSON);
+}
+
+/**
+ * Pushes the result of a firmware update to the web page.
+ * @param flash_successful true if the new firmware is booted on the next restart.
+ * @param err reason of a failed update, sent by name so the page can explain e.g. ESP_ERR_INVALID_VERSION.
+ */
+static void http_server_OTA_result(bool flash_successful, esp_err_t err)
+{
+	char resultJSON[100];
+
+	if (flash_successful)
+	{
+		sprintf(resultJSON, "{\"phase\":\"done\",\"ota_update_status\":%d}", OTA_UPDATE_SUCCESSFUL);
+	}
+	else
+	{
+		snprintf(resultJSON, sizeof(resultJSON), "{\"phase\":\"done\",\"ota_update_status\":%d,\"error\":\"%s\"}", OTA_UPDATE_FAILED, esp_err_to_name(err));
+	}
+	http_server_ws_broadcast(resultJSON);
 }
 
 /**
- * Sends the .ico (icon) file when accessing the web page.
+ * Compares a path with the path of a web page asset, for bsearch.
+ */
+static int http_server_compare_asset(const void *path, const void *asset)
+{
+	return strcmp((const char *)path, ((const webpage_asset_t *)asset)->path);
+}
+
+/**
+ * Checks an Accept-Encoding header for gzip. Codings are compared case-insensitively and a q-value of 0
+ * refuses a coding, e.g. "gzip;q=0". The wildcard "*" stands for gzip unless gzip is listed on its own.
+ * @param accept_encoding value of the Accept-Encoding header.
+ * @return true if gzip is accepted, otherwise false.
+ */
+static bool http_server_accepts_gzip(const char *accept_encoding)
+{
+	float gzip_q = -1.0f;
+	float wildcard_q = -1.0f;
+	const char *pos = accept_encoding;
+
+	while (*pos != '\0')
+	{
+		char coding[48];
+		size_t len = strcspn(pos, ",");
+		size_t copy_len = MIN(len, sizeof(coding) - 1);
+		float q = 1.0f;
+
+		memcpy(coding, pos, copy_len);
+		coding[copy_len] = '\0';
+		pos += len + (pos[len] == ',');
+
+		// Parameters follow the name after a ';', only q matters
+		char *name = coding + strspn(coding, " \t");
+		size_t name_len = strcspn(name, "; \t");
+		for (char *param = strchr(name, ';'); param != NULL; param = strchr(param, ';'))
+		{
+			param += 1 + strspn(param + 1, " \t");
+			if ((param[0] == 'q' || param[0] == 'Q') && param[1] == '=')
+			{
+				q = strtof(&param[2], NULL);
+			}
+		}
+
+		if ((name_len == 4 && strncasecmp(name, "gzip", 4) == 0) || (name_len == 6 && strncasecmp(name, "x-gzip", 6) == 0))
+		{
+			gzip_q = q;
+		}
+		else if (name_len == 1 && name[0] == '*')
+		{
+			wildcard_q = q;
+		}
+	}
+
+	return (gzip_q >= 0.0f) ? gzip_q > 0.0f : wildcard_q > 0.0f;
+}
+
+/**
+ * Web page asset handler serves every embedded file (index.html, app.css, app.js, JQuery and favicon.ico)
+ * from the table generated at build time. Assets are stored gzip compressed and uncompressed:
+ * clients which do not send Accept-Encoding accept any encoding and get gzip, like clients which accept gzip,
+ * all others get the uncompressed asset.
+ * A client which has the asset cached already gets 304 Not Modified without a body.
  * @param req HTTP request for which the uri needs to be handled.
  * @return ESP_OK
  */
-static esp_err_t http_server_favicon_ico_handler(httpd_req_t *req)
+static esp_err_t http_server_asset_handler(httpd_req_t *req)
 {
-	ESP_LOGI(TAG, "favicon.ico requested");
+	char path[64];
+	char accept_encoding[256];
+	char if_none_match[128];
 
-	httpd_resp_set_type(req, "image/x-icon");
-	httpd_resp_send(req, (const char *)favicon_ico_start, favicon_ico_end - favicon_ico_start);
+	// The query string is not part of the path
+	size_t path_len = strcspn(req->uri, "?");
+	if (path_len >= sizeof(path))
+	{
+		return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, NULL);
+	}
+	memcpy(path, req->uri, path_len);
+	path[path_len] = '\0';
+
+	const webpage_asset_t *asset = bsearch(path, webpage_assets, webpage_asset_count, sizeof(webpage_asset_t), http_server_compare_asset);
+	if (asset == NULL)
+	{
+		return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, NULL);
+	}
+
+	ESP_LOGI(TAG, "%s requested", asset->path);
+
+	// A header cut short by the buffer is parsed as far as it goes, without gzip in it the uncompressed asset is sent
+	esp_err_t err = httpd_req_get_hdr_value_str(req, "Accept-Encoding", accept_encoding, sizeof(accept_encoding));
+	bool gzip = (err == ESP_ERR_NOT_FOUND) || ((err == ESP_OK || err == ESP_ERR_HTTPD_RESULT_TRUNC) && http_server_accepts_gzip(accept_encoding));
+	const char *etag = gzip ? asset->etag : asset->identity_etag;
+
+	httpd_resp_set_hdr(req, "ETag", etag);
+	httpd_resp_set_hdr(req, "Cache-Control", asset->cache_control);
+
+	// The response depends on Accept-Encoding, caches must not hand the gzip body to a client which did not ask for it
+	httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+
+	if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+		(strstr(if_none_match, etag) != NULL || strcmp(if_none_match, "*") == 0))
+	{
+		httpd_resp_set_status(req, "304 Not Modified");
+		httpd_resp_send(req, NULL, 0);
+		return ESP_OK;
+	}
+
+	httpd_resp_set_type(req, asset->type);
+	if (gzip)
+	{
+		httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+		httpd_resp_send(req, (const char *)asset->data, asset->len);
+	}
+	else
+	{
+		httpd_resp_send(req, (const char *)asset->identity_data, asset->identity_len);
+	}
 
 	return ESP_OK;
 }
 
 /**
- * Receives the .bin file fia the web page and handles the firmware update
+ * Gets the settings of a firmware upload from the request.
+ * The image may be compressed with heatshrink, given by the "Content-Encoding: heatshrink" header or the encoding=heatshrink query parameter,
+ * and may be a bsdiff patch against the running image, given by the delta=1 query parameter.
+ * Images of the running version are refused unless the force=1 query parameter is given.
+ * The SHA-256 of the resulting image can be given by the "X-Firmware-SHA256" header or the sha256 query parameter,
+ * the image is then only booted if it matches.
+ * @param req HTTP request of the upload.
+ * @param config set to the settings of the upload.
+ * @return true on success, false if the given SHA-256 is malformed or the digest header or query string is too long to be read,
+ * so a digest is never skipped because it did not fit.
+ */
+static bool http_server_get_OTA_config(httpd_req_t *req, ota_writer_config_t *config)
+{
+	char query[160];
+	char value[16];
+	char sha256[72];
+	esp_err_t err;
+
+	memset(config, 0, sizeof(*config));
+
+	if ((err = httpd_req_get_hdr_value_str(req, "X-Firmware-SHA256", sha256, sizeof(sha256))) == ESP_OK)
+	{
+		if (!ota_digest_from_hex(sha256, config->sha256))
+		{
+			return false;
+		}
+		config->verify_sha256 = true;
+	}
+	else if (err != ESP_ERR_NOT_FOUND)
+	{
+		return false;
+	}
+
+	if (httpd_req_get_hdr_value_str(req, "Content-Encoding", value, sizeof(value)) == ESP_OK && strcasecmp(value, "heatshrink") == 0)
+	{
+		config->encoding = OTA_WRITER_ENCODING_HEATSHRINK;
+	}
+
+	if ((err = httpd_req_get_url_query_str(req, query, sizeof(query))) == ESP_OK)
+	{
+		if (httpd_query_key_value(query, "encoding", value, sizeof(value)) == ESP_OK && strcasecmp(value, "heatshrink") == 0)
+		{
+			config->encoding = OTA_WRITER_ENCODING_HEATSHRINK;
+		}
+		if (httpd_query_key_value(query, "delta", value, sizeof(value)) == ESP_OK && strcmp(value, "1") == 0)
+		{
+			config->delta = true;
+		}
+		if (httpd_query_key_value(query, "force", value, sizeof(value)) == ESP_OK && strcmp(value, "1") == 0)
+		{
+			config->force = true;
+		}
+		if ((err = httpd_query_key_value(query, "sha256", sha256, sizeof(sha256))) == ESP_OK)
+		{
+			if (!ota_digest_from_hex(sha256, config->sha256))
+			{
+				return false;
+			}
+			config->verify_sha256 = true;
+		}
+		else if (err != ESP_ERR_NOT_FOUND)
+		{
+			return false;
+		}
+	}
+	else if (err != ESP_ERR_NOT_FOUND)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Answers an upload whose OTA session could not be started. Nothing is broadcast: if the writer is busy,
+ * the clients watching the progress belong to the upload which owns it.
+ * @param req HTTP request of the upload.
+ * @param err error returned by ota_writer_begin.
+ * @return ESP_OK, otherwise an error code.
+ */
+static esp_err_t http_server_OTA_begin_failed(httpd_req_t *req, esp_err_t err)
+{
+	if (err == ESP_ERR_INVALID_STATE)
+	{
+		httpd_resp_set_status(req, "409 Conflict");
+		httpd_resp_set_type(req, "text/plain");
+		return httpd_resp_sendstr(req, "Firmware update already in progress");
+	}
+
+	return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "OTA begin failed");
+}
+
+/**
+ * Pushes the result of a firmware upload to the web page, tells the monitor task and answers the upload.
+ * A rejected upload is answered before its body has been received, the connection is closed
+ * instead of reading the rest of the image.
+ * @param req HTTP request of the upload.
+ * @param flash_successful true if the new firmware is booted on the next restart.
+ * @param err result of the update.
+ * @param body_left true if the body was not received completely.
+ * @return ESP_OK, otherwise an error code.
+ */
+static esp_err_t http_server_OTA_respond(httpd_req_t *req, bool flash_successful, esp_err_t err, bool body_left)
+{
+	esp_err_t ret;
+
+	http_server_OTA_result(flash_successful, err);
+	http_server_monitor_send_message(flash_successful ? HTTP_MSG_OTA_UPDATE_SUCCESSFUL : HTTP_MSG_OTA_UPDATE_FAILED);
+
+	if (body_left)
+	{
+		httpd_resp_set_hdr(req, "Connection", "close");
+	}
+
+	if (flash_successful)
+	{
+		httpd_resp_set_type(req, "application/json");
+		ret = httpd_resp_sendstr(req, "{\"ota_update_status\":1}");
+	}
+	else if (err == ESP_ERR_INVALID_CRC)
+	{
+		ret = httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Firmware SHA-256 mismatch");
+	}
+	else if (err == ESP_ERR_INVALID_VERSION)
+	{
+		ret = httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Firmware version already running, use force=1");
+	}
+	else if (err == ESP_ERR_OTA_VALIDATE_FAILED || err == ESP_ERR_INVALID_SIZE)
+	{
+		ret = httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Not a firmware image for this device");
+	}
+	else if (err == ESP_ERR_INVALID_ARG)
+	{
+		ret = httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Malformed or incomplete upload");
+	}
+	else
+	{
+		ret = httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Firmware update failed");
+	}
+
+	if (body_left)
+	{
+		httpd_sess_trigger_close(http_server_handle, httpd_req_to_sockfd(req));
+	}
+
+	return ret;
+}
+
+/**
+ * Multipart parser callback, passes the image bytes of the uploaded file on to the OTA writer.
+ * @param ctx esp_err_t set to the result of the write.
+ * @param data image bytes.
+ * @param len number of bytes in data.
+ * @return 0 to continue, otherwise the error reported by the OTA writer.
+ */
+static int http_server_OTA_data_cb(void *ctx, const uint8_t *data, size_t len)
+{
+	esp_err_t *err = ctx;
+
+	*err = ota_writer_write(data, len);
+
+	return *err;
+}
+
+/**
+ * Receives the .bin file fia the web page and handles the firmware update.
+ * The data is received on an async worker, stripped of the web form framing by the multipart parser
+ * and handed over to the OTA writer task, so flash programming overlaps with waiting on the socket.
  * @param req HTTP request for which the uri needs to be handled.
  * @return ESP_OK, otherwise ESP_FAIL if timeout occurs and the update cannot be started.
  */
 esp_err_t http_server_OTA_update_handler(httpd_req_t *req)
 {
-	esp_ota_handle_t ota_handle;
+	// The upload runs on an async worker, so the server keeps serving other requests meanwhile
+	if (!http_server_is_async_worker())
+	{
+		return http_server_queue_async(req, http_server_OTA_update_handler);
+	}
 
 	char ota_buff[1024];
+	char content_type[128];
 	int content_length = req->content_len;
 	int content_received = 0;
 	int recv_len;
-	bool is_req_body_started = false;
 	bool flash_successful = false;
+	multipart_parser_t parser;
+	multipart_parser_result_e result = MULTIPART_PARSER_OK;
+	ota_writer_config_t ota_config;
+	esp_err_t err;
+	esp_err_t write_err = ESP_OK;
+
+	// Get the boundary of the web form data
+	if (httpd_req_get_hdr_value_str(req, "Content-Type", content_type, sizeof(content_type)) != ESP_OK ||
+		multipart_parser_init(&parser, content_type, http_server_OTA_data_cb, &write_err) != 0)
+	{
+		ESP_LOGI(TAG, "http_server_OTA_update_handler: Expected multipart/form-data");
+		httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected multipart/form-data");
+		return ESP_FAIL;
+	}
 
-	const esp_partition_t *update_partition = esp_ota_get_next_update_partition(NULL);
+	printf("http_server_OTA_update_handler: OTA file size: %d\r\n", content_length);
 
-	do
+	if (!http_server_get_OTA_config(req, &ota_config))
+	{
+		httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Malformed SHA-256 or query string");
+		return ESP_FAIL;
+	}
+	if ((err = ota_writer_begin(&ota_config)) != ESP_OK)
+	{
+		printf("http_server_OTA_update_handler: Error with OTA begin, cancelling OTA\r\n");
+		http_server_OTA_begin_failed(req, err);
+		return ESP_FAIL;
+	}
+	http_server_OTA_progress("receiving", 0, content_length, true);
+
+	int64_t last_data = esp_timer_get_time();
+	while (content_received < content_length && result == MULTIPART_PARSER_OK)
 	{
 		// Read the data for the request
-		if ((recv_len = httpd_req_recv(req, ota_buff, MIN(content_length, sizeof(ota_buff)))) < 0)
+		int64_t recv_start = esp_timer_get_time();
+		recv_len = httpd_req_recv(req, ota_buff, MIN(content_length - content_received, sizeof(ota_buff)));
+		ota_stats_record((recv_len == HTTPD_SOCK_ERR_TIMEOUT) ? OTA_STATS_PHASE_SOCKET_WAIT : OTA_STATS_PHASE_RECV, recv_start);
+		if (recv_len <= 0)
 		{
 			// Check if timeout occurred
 			if (recv_len == HTTPD_SOCK_ERR_TIMEOUT)
 			{
-				ESP_LOGI(TAG, "http_server_OTA_update_handler: Socket Timeout");
-				continue; ///> Retry receiving if timeout occurred
+				if (esp_timer_get_time() - last_data < HTTP_SERVER_OTA_STALL_TIMEOUT_US)
+				{
+					ESP_LOGI(TAG, "http_server_OTA_update_handler: Socket Timeout");
+					continue; ///> Retry receiving if timeout occurred
+				}
+				ESP_LOGE(TAG, "http_server_OTA_update_handler: No data for %d s, cancelling OTA", HTTP_SERVER_OTA_STALL_TIMEOUT_US / 1000000);
+				ota_writer_abort();
+				http_server_OTA_result(false, ESP_ERR_TIMEOUT);
+				http_server_monitor_send_message(HTTP_MSG_OTA_UPDATE_FAILED);
+				httpd_resp_send_err(req, HTTPD_408_REQ_TIMEOUT, "Upload stalled");
+				return ESP_FAIL;
 			}
 			ESP_LOGI(TAG, "http_server_OTA_update_handler: OTA other Error %d", recv_len);
+			ota_writer_abort();
+			http_server_OTA_result(false, ESP_FAIL);
 			return ESP_FAIL;
 		}
-		printf("http_server_OTA_update_handler: OTA RX: %d of %d\r", content_received, content_length);
+		content_received += recv_len;
+		last_data = esp_timer_get_time();
+		http_server_OTA_progress("receiving", content_received, content_length, false);
+
+		// Only the image bytes reach the OTA writer, the form headers and boundaries are dropped
+		result = multipart_parser_feed(&parser, (const uint8_t *)ota_buff, recv_len);
+	}
+
+	if (result == MULTIPART_PARSER_DONE)
+	{
+		// Wait for the writer task to program the rest, then validate and update the boot partition
+		http_server_OTA_progress("verifying", content_received, content_length, true);
+		err = ota_writer_finish();
+		flash_successful = (err == ESP_OK);
+	}
+	else
+	{
+		ESP_LOGI(TAG, "http_server_OTA_update_handler: Malformed, incomplete or rejected upload, cancelling OTA");
+		ota_writer_abort();
+		err = (write_err != ESP_OK) ? write_err : ESP_ERR_INVALID_ARG;
+	}
+
+	// We won't update the global variables throughout the file, so send the message about the status
+	http_server_OTA_respond(req, flash_successful, err, content_received < content_length);
+
+	return ESP_OK;
+}
+
+/**
+ * Sends the point an interrupted firmware upload can be continued at.
+ * Responds with {"offset":0,"total":0,"sha256":""} if there is nothing to resume.
+ * @param req HTTP request to respond to.
+ * @param status HTTP status line e.g. HTTPD_200.
+ * @return ESP_OK, otherwise an error code.
+ */
+static esp_err_t http_server_send_resume_point(httpd_req_t *req, const char *status)
+{
+	char resumeJSON[128];
+	char sha256_hex[OTA_DIGEST_HEX_LEN + 1] = "";
+	ota_writer_resume_point_t point;
+
+	if (ota_writer_get_resume_point(&point) == ESP_OK)
+	{
+		ota_digest_to_hex(point.sha256, sha256_hex);
+	}
+
+	sprintf(resumeJSON, "{\"offset\":%u,\"total\":%u,\"sha256\":\"%s\"}", (unsigned)point.offset, (unsigned)point.image_size, sha256_hex);
+
+	httpd_resp_set_status(req, status);
+	httpd_resp_set_type(req, "application/json");
+
+	return httpd_resp_sendstr(req, resumeJSON);
+}
 
-		// Is this the first data we are receiving
-		// If so, it will have the information in the header that we need.
-		if (!is_req_body_started)
+/**
+ * Gets the byte range of a continued upload from the "Content-Range: bytes <first>-<last>/<total>" header.
+ * Without the header the body is the whole image.
+ * @param req HTTP request of the upload.
+ * @param config resume_offset and image_size are set from the range.
+ * @return true if the range is well formed and covers the rest of the image, otherwise false.
+ */
+static bool http_server_get_OTA_range(httpd_req_t *req, ota_writer_config_t *config)
+{
+	char range[64];
+	unsigned first, last, total;
+
+	if (httpd_req_get_hdr_value_str(req, "Content-Range", range, sizeof(range)) != ESP_OK)
+	{
+		// The size of compressed images and patches says nothing about the size of the image
+		if (config->encoding == OTA_WRITER_ENCODING_NONE && !config->delta)
 		{
-			is_req_body_started = true;
+			config->image_size = req->content_len;
+		}
+		return true;
+	}
 
-			// Get the location of the .bin file content (remove the web form data)
-			char *body_start_p = strstr(ota_buff, "\r\n\r\n") + 4;
-			int body_part_len = recv_len - (body_start_p - ota_buff);
+	if (sscanf(range, "bytes %u-%u/%u", &first, &last, &total) != 3 || first > last || last + 1 != total || last - first + 1 != req->content_len)
+	{
+		return false;
+	}
+	config->resume_offset = first;
+	config->image_size = total;
 
-			printf("http_server_OTA_update_handler: OTA file size: %d\r\n", content_length);
+	return true;
+}
 
-			esp_err_t err = esp_ota_begin(update_partition, OTA_SIZE_UNKNOWN, &ota_handle);
-			if (err != ESP_OK)
-			{
-				printf("http_server_OTA_update_handler: Error with OTA begin, cancelling OTA\r\n");
-				return ESP_FAIL;
-			}
-			else
-			{
-				printf("http_server_OTA_update_handler: Writing to partition subtype %d at offset 0x%lx\r\n", update_partition->subtype, update_partition->address);
-			}
+/**
+ * Receives a raw firmware image (application/octet-stream) and handles the firmware update.
+ * There is no web form to parse, the data is received straight into the sector sized buffers of the OTA writer.
+ * Intended for scripted uploads e.g. curl -T firmware.bin http://192.168.0.1/firmware
+ * Images compressed with heatshrink are sent with the "Content-Encoding: heatshrink" header,
+ * patches against the running image to /firmware?delta=1
+ * Plain images can be resumed: progress is checkpointed while writing, GET /firmware reports the offset to continue at
+ * and the rest of the image is sent with "Content-Range: bytes <offset>-<total - 1>/<total>".
+ * @param req HTTP request for which the uri needs to be handled.
+ * @return ESP_OK, otherwise ESP_FAIL if the update cannot be started or the connection fails.
+ */
+esp_err_t http_server_firmware_put_handler(httpd_req_t *req)
+{
+	// The upload runs on an async worker, so the server keeps serving other requests meanwhile
+	if (!http_server_is_async_worker())
+	{
+		return http_server_queue_async(req, http_server_firmware_put_handler);
+	}
 
-			// Write this first part of the data
-			esp_ota_write(ota_handle, body_start_p, body_part_len);
-			content_received += body_part_len;
+	int content_length = req->content_len;
+	int content_received = 0;
+	int recv_len;
+	bool flash_successful = false;
+	ota_writer_config_t ota_config;
+	esp_err_t err;
+
+	if (content_length <= 0)
+	{
+		httpd_resp_send_err(req, HTTPD_411_LENGTH_REQUIRED, "Content-Length required");
+		return ESP_FAIL;
+	}
+
+	printf("http_server_firmware_put_handler: OTA file size: %d\r\n", content_length);
+
+	if (!http_server_get_OTA_config(req, &ota_config))
+	{
+		httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Malformed SHA-256 or query string");
+		return ESP_FAIL;
+	}
+	if (!http_server_get_OTA_range(req, &ota_config))
+	{
+		http_server_send_resume_point(req, "416 Range Not Satisfiable");
+		return ESP_FAIL;
+	}
+	ota_config.resumable = (ota_config.encoding == OTA_WRITER_ENCODING_NONE && !ota_config.delta);
+
+	if ((err = ota_writer_begin(&ota_config)) != ESP_OK)
+	{
+		printf("http_server_firmware_put_handler: Error with OTA begin, cancelling OTA\r\n");
+		if (err == ESP_ERR_INVALID_ARG && ota_config.resume_offset > 0)
+		{
+			// The client has to continue at the offset which was checkpointed
+			http_server_send_resume_point(req, "416 Range Not Satisfiable");
 		}
 		else
 		{
-			// Write OTA data
-			esp_ota_write(ota_handle, ota_buff, recv_len);
-			content_received += recv_len;
+			http_server_OTA_begin_failed(req, err);
 		}
+		return ESP_FAIL;
+	}
+	http_server_OTA_progress("receiving", 0, content_length, true);
 
-	} while (recv_len > 0 && content_received < content_length);
-
-	if (esp_ota_end(ota_handle) == ESP_OK)
+	int64_t last_data = esp_timer_get_time();
+	while (content_received < content_length)
 	{
-		// Lets update the partition
-		if (esp_ota_set_boot_partition(update_partition) == ESP_OK)
+		size_t free_len;
+		uint8_t *ota_buff = ota_writer_get_buffer(&free_len);
+
+		// Read the data for the request straight into the OTA writer
+		int64_t recv_start = esp_timer_get_time();
+		recv_len = httpd_req_recv(req, (char *)ota_buff, MIN(content_length - content_received, free_len));
+		ota_stats_record((recv_len == HTTPD_SOCK_ERR_TIMEOUT) ? OTA_STATS_PHASE_SOCKET_WAIT : OTA_STATS_PHASE_RECV, recv_start);
+		if (recv_len <= 0)
 		{
-			const esp_partition_t *boot_partition = esp_ota_get_boot_partition();
-			ESP_LOGI(TAG, "http_server_OTA_update_handler: Next boot partition subtype %d at offset 0x%lx", boot_partition->subtype, boot_partition->address);
-			flash_successful = true;
+			// Check if timeout occurred
+			if (recv_len == HTTPD_SOCK_ERR_TIMEOUT)
+			{
+				if (esp_timer_get_time() - last_data < HTTP_SERVER_OTA_STALL_TIMEOUT_US)
+				{
+					ESP_LOGI(TAG, "http_server_firmware_put_handler: Socket Timeout");
+					continue; ///> Retry receiving if timeout occurred
+				}
+				ESP_LOGE(TAG, "http_server_firmware_put_handler: No data for %d s, cancelling OTA", HTTP_SERVER_OTA_STALL_TIMEOUT_US / 1000000);
+				ota_writer_abort();
+				http_server_OTA_result(false, ESP_ERR_TIMEOUT);
+				http_server_monitor_send_message(HTTP_MSG_OTA_UPDATE_FAILED);
+				httpd_resp_send_err(req, HTTPD_408_REQ_TIMEOUT, "Upload stalled");
+				return ESP_FAIL;
+			}
+			ESP_LOGI(TAG, "http_server_firmware_put_handler: OTA other Error %d", recv_len);
+			ota_writer_abort(); ///> Keeps the progress, see GET /firmware
+			http_server_OTA_result(false, ESP_FAIL);
+			return ESP_FAIL;
 		}
-		else
+		content_received += recv_len;
+		last_data = esp_timer_get_time();
+		http_server_OTA_progress("receiving", content_received, content_length, false);
+
+		if ((err = ota_writer_commit(recv_len)) != ESP_OK)
 		{
-			ESP_LOGI(TAG, "http_server_OTA_update_handler: FLASHED ERROR!!!");
+			break;
 		}
 	}
+
+	if (content_received == content_length)
+	{
+		// Wait for the writer task to program the rest, then validate and update the boot partition
+		http_server_OTA_progress("verifying", content_received, content_length, true);
+		err = ota_writer_finish();
+		flash_successful = (err == ESP_OK);
+	}
 	else
 	{
-		ESP_LOGI(TAG, "http_server_OTA_update_handler: esp_ota_end ERROR!!!");
+		ota_writer_abort();
 	}
 
-	// We won't update the global variables throughout the file, so send the message about the status
-	if (flash_successful) { http_server_monitor_send_message(HTTP_MSG_OTA_UPDATE_SUCCESSFUL); } else { http_server_monitor_send_message(HTTP_MSG_OTA_UPDATE_FAILED); }
+	http_server_OTA_respond(req, flash_successful, err, content_received < content_length);
 
 	return ESP_OK;
 }
 
 /**
- * OTA status handler responds with the firmware update status after the OTA update is started
- * and responds with the compile time/date when the page is first requested
+ * Firmware resume handler responds with the point an interrupted upload to PUT /firmware can be continued at
  * @param req HTTP request for which the uri needs to be handled
  * @return ESP_OK
  */
-esp_err_t http_server_OTA_status_handler(httpd_req_t *req)
+esp_err_t http_server_firmware_get_handler(httpd_req_t *req)
 {
-	char otaJSON[100];
+	ESP_LOGI(TAG, "/firmware resume point requested");
 
-	ESP_LOGI(TAG, "OTAstatus requested");
+	return http_server_send_resume_point(req, HTTPD_200);
+}
 
-	sprintf(otaJSON, "{\"ota_update_status\":%d,\"compile_time\":\"%s\",\"compile_date\":\"%s\"}", g_fw_update_status, __TIME__, __DATE__);
+/**
+ * OTA statistics handler responds with the phase timings of the last firmware updates
+ * @param req HTTP request for which the uri needs to be handled
+ * @return ESP_OK, otherwise ESP_ERR_NO_MEM
+ */
+esp_err_t http_server_OTA_stats_handler(httpd_req_t *req)
+{
+	ESP_LOGI(TAG, "/ota/stats requested");
+
+	char *statsJSON = malloc(OTA_STATS_JSON_SIZE);
+	if (statsJSON == NULL)
+	{
+		httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+		return ESP_ERR_NO_MEM;
+	}
+
+	int len = ota_stats_get_json(statsJSON, OTA_STATS_JSON_SIZE);
+	if (len < 0)
+	{
+		ESP_LOGE(TAG, "http_server_OTA_stats_handler: Statistics do not fit %u bytes", (unsigned)OTA_STATS_JSON_SIZE);
+		httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Statistics too large");
+		free(statsJSON);
+		return ESP_OK;
+	}
 
 	httpd_resp_set_type(req, "application/json");
-	httpd_resp_send(req, otaJSON, strlen(otaJSON));
+	httpd_resp_send(req, statsJSON, len);
+	free(statsJSON);
 
 	return ESP_OK;
 }
 
 /**
- * DHT sensor readings JSON handler responds with DHT22 sensor data
+ * OTA progress WebSocket handler, the web page listens on /ota/ws for the progress of firmware updates
+ * instead of polling /OTAstatus while the upload is running
  * @param req HTTP request for which the uri needs to be handled
- * @return ESP_OK
+ * @return ESP_OK, otherwise an error code closing the connection
  */
-static esp_err_t http_server_get_dht_sensor_readings_json_handler(httpd_req_t *req)
+esp_err_t http_server_OTA_ws_handler(httpd_req_t *req)
 {
-	ESP_LOGI(TAG, "/dhtSensor.json requested");
+	uint8_t payload[32];
+	httpd_ws_frame_t frame;
 
-	char dhtSensorJSON[100];
+	if (req->method == HTTP_GET)
+	{
+		ESP_LOGI(TAG, "/ota/ws connected");
+		return ESP_OK;
+	}
 
-	sprintf(dhtSensorJSON, "{\"temp\":%.1f,\"humidity\":%.1f}", dht11_get_temperature(), dht11_get_humidity());
+	// Clients only listen, whatever they send is read and dropped
+	memset(&frame, 0, sizeof(frame));
+	esp_err_t err = httpd_ws_recv_frame(req, &frame, 0);
+	if (err != ESP_OK || frame.len > sizeof(payload))
+	{
+		return ESP_FAIL;
+	}
+	frame.payload = payload;
+
+	return httpd_ws_recv_frame(req, &frame, frame.len);
+}
+
+/**
+ * Sends a cached JSON response, building it first if the data changed since it was cached.
+ * @param req HTTP request for which the uri needs to be handled.
+ * @param cache cached response.
+ * @param version current version of the data the response is made from.
+ * @param build builds the response from the current data.
+ * @return ESP_OK, a body which does not fit the cache is answered with 500 and not cached.
+ */
+static esp_err_t http_server_send_json_cached(httpd_req_t *req, http_server_json_cache_t *cache, uint32_t version, http_server_json_build_t build)
+{
+	char body[sizeof(cache->body)];
+	size_t len;
+
+	xSemaphoreTake(http_server_json_cache_mutex, portMAX_DELAY);
+	if (!cache->valid || cache->version != version)
+	{
+		int built = build(cache->body, sizeof(cache->body));
+
+		cache->valid = false;
+		if (built < 0 || (size_t)built >= sizeof(cache->body))
+		{
+			xSemaphoreGive(http_server_json_cache_mutex);
+			ESP_LOGE(TAG, "http_server_send_json_cached: response of %d bytes does not fit %u", built, (unsigned)sizeof(cache->body));
+			return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Response too large");
+		}
+		cache->len = built;
+		cache->version = version;
+		cache->valid = true;
+	}
+	len = cache->len;
+	memcpy(body, cache->body, len);
+	xSemaphoreGive(http_server_json_cache_mutex);
 
 	httpd_resp_set_type(req, "application/json");
-	httpd_resp_send(req, dhtSensorJSON, strlen(dhtSensorJSON));
+	httpd_resp_send(req, body, len);
 
 	return ESP_OK;
 }
 
+/**
+ * Builds the OTAstatus response.
+ */
+static int http_server_build_OTA_status(char *buf, size_t len)
+{
+	return snprintf(buf, len, "{\"ota_update_status\":%d,\"compile_time\":\"%s\",\"compile_date\":\"%s\"}", g_fw_update_status, __TIME__, __DATE__);
+}
+
+/**
+ * Builds the dhtSensor.json response.
+ */
+static int http_server_build_dht_sensor(char *buf, size_t len)
+{
+	sensor_manager_reading_t reading = { 0 };
+	size_t pos = 0;
+
+	// Appends to buf, stopping at its end. Once a part is cut off pos is len or more, which the caller takes as truncation
+#define HTTP_SERVER_APPEND(...)	do { if (pos < len) { pos += snprintf(&buf[pos], len - pos, __VA_ARGS__); } } while (0)
+
+	// The first sensor is also at the top level, where the web page reads it from
+	sensor_manager_get_reading(0, &reading);
+	HTTP_SERVER_APPEND("{\"temp\":%.1f,\"humidity\":%.1f,\"seq\":%lu,\"sensors\":[", reading.sample.temperature, reading.sample.humidity,
+			(unsigned long)sensor_manager_get_sequence());
+
+	for (size_t id = 0; id < sensor_manager_get_count(); id++)
+	{
+		sensor_manager_get_reading(id, &reading);
+		HTTP_SERVER_APPEND("%s{\"id\":%u,\"name\":\"%s\",\"gpio\":%d,\"valid\":%s,\"temp\":%.1f,\"humidity\":%.1f,\"time_ms\":%lld,\"seq\":%lu,\"error\":\"%s\"}",
+				(id > 0) ? "," : "", (unsigned)id, reading.name, reading.gpio_num, reading.valid ? "true" : "false", reading.sample.temperature,
+				reading.sample.humidity, reading.sample.timestamp_us / 1000, (unsigned long)reading.sequence, esp_err_to_name(reading.last_error));
+	}
+	HTTP_SERVER_APPEND("]}");
+
+#undef HTTP_SERVER_APPEND
+
+	return pos;
+}
+
+/**
+ * OTA status handler responds with the firmware update status after the OTA update is started
+ * and responds with the compile time/date when the page is first requested
+ * @param req HTTP request for which the uri needs to be handled
+ * @return ESP_OK
+ */
+esp_err_t http_server_OTA_status_handler(httpd_req_t *req)
+{
+	ESP_LOGI(TAG, "OTAstatus requested");
+
+	// The compile time and date never change, only the update status does
+	return http_server_send_json_cached(req, &http_server_OTA_status_cache, (uint32_t)g_fw_update_status, http_server_build_OTA_status);
+}
+
+/**
+ * DHT sensor readings JSON handler responds with DHT sensor data.
+ * The ETag is the sequence number of the reading, so a client which has it already gets 304 Not Modified.
+ * With ?after=<seq> the request is held on an async worker until there is a newer reading or
+ * HTTP_SERVER_LONG_POLL_TIMEOUT_MS passed. One worker is always left for firmware uploads,
+ * if none can be spared the current reading is sent right away.
+ * @param req HTTP request for which the uri needs to be handled
+ * @return ESP_OK
+ */
+static esp_err_t http_server_get_dht_sensor_readings_json_handler(httpd_req_t *req)
+{
+	char query[32];
+	char value[12];
+	char if_none_match[32];
+	char etag[16];
+	uint32_t sequence;
+
+	if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+		httpd_query_key_value(query, "after", value, sizeof(value)) == ESP_OK)
+	{
+		uint32_t after = strtoul(value, NULL, 10);
+
+		if (http_server_is_async_worker())
+		{
+			// Blocks until the sensor manager publishes a new reading
+			sensor_manager_wait_for_sequence(after, HTTP_SERVER_LONG_POLL_TIMEOUT_MS);
+		}
+		else if (sensor_manager_get_sequence() == after && uxSemaphoreGetCount(http_server_async_idle) > 1)
+		{
+			return http_server_queue_async(req, http_server_get_dht_sensor_readings_json_handler);
+		}
+	}
+
+	ESP_LOGI(TAG, "/dhtSensor.json requested");
+
+	sequence = sensor_manager_get_sequence();
+	snprintf(etag, sizeof(etag), "\"%lu\"", (unsigned long)sequence);
+	httpd_resp_set_hdr(req, "ETag", etag);
+	httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+	if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK && strstr(if_none_match, etag) != NULL)
+	{
+		httpd_resp_set_status(req, "304 Not Modified");
+		httpd_resp_send(req, NULL, 0);
+		return ESP_OK;
+	}
+
+	// Float formatting is slow, the body is only formatted again once there is a new reading
+	return http_server_send_json_cached(req, &http_server_dht_sensor_cache, sequence, http_server_build_dht_sensor);
+}
+
 /**
  * Sets up the default httpd server configuration.
  * @return http server instance handle if successful, NULL otherwise.
@@ -346,6 +1146,24 @@ static httpd_handle_t http_server_configure(void)
 	// Create the message queue
 	http_server_monitor_queue_handle = xQueueCreate(3, sizeof(http_server_queue_message_t));
 
+	// Create the mutex guarding the cached JSON responses
+	if (http_server_json_cache_mutex == NULL)
+	{
+		http_server_json_cache_mutex = xSemaphoreCreateMutex();
+	}
+
+	// Create the async workers for long running requests, one per core
+	if (http_server_async_queue == NULL)
+	{
+		http_server_async_queue = xQueueCreate(HTTP_SERVER_ASYNC_WORKER_COUNT, sizeof(http_server_async_req_t));
+		http_server_async_idle = xSemaphoreCreateCounting(HTTP_SERVER_ASYNC_WORKER_COUNT, 0);
+		for (int i = 0; i < HTTP_SERVER_ASYNC_WORKER_COUNT; i++)
+		{
+			xTaskCreatePinnedToCore(&http_server_async_worker, "http_async_worker", HTTP_SERVER_ASYNC_WORKER_STACK_SIZE, NULL, HTTP_SERVER_ASYNC_WORKER_PRIORITY,
+					&http_server_async_workers[i], i % portNUM_PROCESSORS);
+		}
+	}
+
 	// The core that the HTTP server will run on
 	config.core_id = HTTP_SERVER_TASK_CORE_ID;
 
@@ -358,6 +1176,9 @@ static httpd_handle_t http_server_configure(void)
 	// Increase uri handlers
 	config.max_uri_handlers = 20;
 
+	// Web page assets are served by a single wildcard handler
+	config.uri_match_fn = httpd_uri_match_wildcard;
+
 	// Increase the timeout limits
 	config.recv_wait_timeout = 10;
 	config.send_wait_timeout = 10;
@@ -372,59 +1193,51 @@ static httpd_handle_t http_server_configure(void)
 	{
 		ESP_LOGI(TAG, "http_server_configure: Registering URI handlers");
 
-		// register query handler
-		httpd_uri_t jquery_js = {
-				.uri = "/jquery-3.3.1.min.js",
-				.method = HTTP_GET,
-				.handler = http_server_jquery_handler,
+		// register OTAupdate handler
+		httpd_uri_t OTA_update = {
+				.uri = "/OTAupdate",
+				.method = HTTP_POST,
+				.handler = http_server_OTA_update_handler,
 				.user_ctx = NULL
 		};
-		httpd_register_uri_handler(http_server_handle, &jquery_js);
+		httpd_register_uri_handler(http_server_handle, &OTA_update);
 
-		// register index.html handler
-		httpd_uri_t index_html = {
-				.uri = "/",
-				.method = HTTP_GET,
-				.handler = http_server_index_html_handler,
+		// register firmware PUT handler (raw image upload)
+		httpd_uri_t firmware_put = {
+				.uri = "/firmware",
+				.method = HTTP_PUT,
+				.handler = http_server_firmware_put_handler,
 				.user_ctx = NULL
 		};
-		httpd_register_uri_handler(http_server_handle, &index_html);
+		httpd_register_uri_handler(http_server_handle, &firmware_put);
 
-		// register app.css handler
-		httpd_uri_t app_css = {
-				.uri = "/app.css",
+		// register firmware GET handler (resume point of an interrupted upload)
+		httpd_uri_t firmware_get = {
+				.uri = "/firmware",
 				.method = HTTP_GET,
-				.handler = http_server_app_css_handler,
+				.handler = http_server_firmware_get_handler,
 				.user_ctx = NULL
 		};
-		httpd_register_uri_handler(http_server_handle, &app_css);
+		httpd_register_uri_handler(http_server_handle, &firmware_get);
 
-		// register app.js handler
-		httpd_uri_t app_js = {
-				.uri = "/app.js",
+		// register OTA statistics handler
+		httpd_uri_t OTA_stats = {
+				.uri = "/ota/stats",
 				.method = HTTP_GET,
-				.handler = http_server_app_js_handler,
+				.handler = http_server_OTA_stats_handler,
 				.user_ctx = NULL
 		};
-		httpd_register_uri_handler(http_server_handle, &app_js);
+		httpd_register_uri_handler(http_server_handle, &OTA_stats);
 
-		// register favicon.ico handler
-		httpd_uri_t favicon_ico = {
-				.uri = "/favicon.ico",
+		// register OTA progress WebSocket handler
+		httpd_uri_t OTA_ws = {
+				.uri = "/ota/ws",
 				.method = HTTP_GET,
-				.handler = http_server_favicon_ico_handler,
-				.user_ctx = NULL
+				.handler = http_server_OTA_ws_handler,
+				.user_ctx = NULL,
+				.is_websocket = true
 		};
-		httpd_register_uri_handler(http_server_handle, &favicon_ico);
-
-		// register OTAupdate handler
-		httpd_uri_t OTA_update = {
-				.uri = "/OTAupdate",
-				.method = HTTP_POST,
-				.handler = http_server_OTA_update_handler,
-				.user_ctx = NULL
-		};
-		httpd_register_uri_handler(http_server_handle, &OTA_update);
+		httpd_register_uri_handler(http_server_handle, &OTA_ws);
 
 		// register OTAstatus handler
 		httpd_uri_t OTA_status = {
@@ -444,6 +1257,15 @@ static httpd_handle_t http_server_configure(void)
 		};
 		httpd_register_uri_handler(http_server_handle, &dht_sensor_json);
 
+		// register web page asset handler, last as it matches every other GET request
+		httpd_uri_t webpage_asset = {
+				.uri = "/*",
+				.method = HTTP_GET,
+				.handler = http_server_asset_handler,
+				.user_ctx = NULL
+		};
+		httpd_register_uri_handler(http_server_handle, &webpage_asset);
+
 		return http_server_handle;
 	}
 
@@ -7,45 +7,12 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
-#include "dht11.h"
+#include "ota_writer.h"
+#include "sensor_manager.h"
 #include "wifi_app.h"
 
-#define DHT11_GPIO GPIO_NUM_4
-#define DHT11_READ_INTERVAL_MS 3000
-
 static const char *TAG = "MAIN";
 
-/**
- * DHT11 sensor reading task
- */
-static void dht11_task(void *pvParameter)
-{
-	ESP_LOGI(TAG, "DHT11 task started on GPIO %d", DHT11_GPIO);
-	
-	dht11_reading_t reading;
-	
-	// Wait for sensor to stabilize after power-on
-	vTaskDelay(pdMS_TO_TICKS(2000));
-	
-	while (1)
-	{
-		esp_err_t result = dht11_read(DHT11_GPIO, &reading);
-		
-		if (result == ESP_OK)
-		{
-			ESP_LOGI(TAG, "Temperature: %.1f°C, Humidity: %.1f%%", 
-					 reading.temperature, reading.humidity);
-		}
-		else
-		{
-			ESP_LOGE(TAG, "Failed to read DHT11 sensor (error: %d)", result);
-		}
-		
-		// Wait before next reading (DHT11 needs minimum 2 seconds between readings)
-		vTaskDelay(pdMS_TO_TICKS(DHT11_READ_INTERVAL_MS));
-	}
-}
-
 void app_main(void)
 {
 	ESP_LOGI(TAG, "Starting application...");
@@ -60,12 +27,15 @@ void app_main(void)
 	ESP_ERROR_CHECK(ret);
 	ESP_LOGI(TAG, "NVS initialized");
 
+	// Erase the idle OTA slot in the background, so the next update starts right away
+	ota_writer_start_pre_erase();
+
 	// Start Wifi
 	wifi_app_start();
 	ESP_LOGI(TAG, "WiFi started");
 
-	// Start DHT11 Sensor task
-	xTaskCreate(&dht11_task, "dht11_task", 4096, NULL, 5, NULL);
-	ESP_LOGI(TAG, "DHT11 task created");
+	// Start reading the DHT sensors
+	sensor_manager_start();
+	ESP_LOGI(TAG, "Sensor manager started");
 }
 
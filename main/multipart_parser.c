@@ -0,0 +1,254 @@
+/*
+ * multipart_parser.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Incremental multipart/form-data parser (RFC 2046 / RFC 7578).
+ *
+ * Body layout:
+ *   [preamble] "--boundary" CRLF headers CRLF CRLF body CRLF "--boundary" ... CRLF "--boundary--" [epilogue]
+ *
+ * The body is scanned for the delimiter "\r\n--boundary". A boundary can never contain CR,
+ * so a partial match that turns out to be body data can only restart on the current byte.
+ * Bytes of a partial match at the end of a chunk are held back without copying them:
+ * they are equal to the start of the delimiter, so they can be re-emitted from it.
+ */
+
+#include <string.h>
+#include <strings.h>
+
+#include "multipart_parser.h"
+
+/**
+ * Passes body bytes of the first part on to the callback.
+ * @return 0 to continue, otherwise the value returned by the callback.
+ */
+static int multipart_parser_emit(multipart_parser_t *parser, const uint8_t *data, size_t len)
+{
+	if (len == 0 || parser->part_index != 0)
+	{
+		return 0;
+	}
+
+	return parser->on_data(parser->ctx, data, len);
+}
+
+int multipart_parser_init(multipart_parser_t *parser, const char *content_type, multipart_parser_data_cb_t on_data, void *ctx)
+{
+	const char *boundary;
+	size_t boundary_len;
+
+	memset(parser, 0, sizeof(*parser));
+
+	if (content_type == NULL || on_data == NULL || strncasecmp(content_type, "multipart/", 10) != 0)
+	{
+		return -1;
+	}
+
+	if ((boundary = strstr(content_type, "boundary=")) == NULL)
+	{
+		return -1;
+	}
+	boundary += 9;
+
+	// The boundary may be quoted
+	if (*boundary == '"')
+	{
+		boundary++;
+		boundary_len = strcspn(boundary, "\"");
+	}
+	else
+	{
+		boundary_len = strcspn(boundary, "; \t");
+	}
+
+	if (boundary_len == 0 || boundary_len > MULTIPART_PARSER_MAX_BOUNDARY_LEN || memchr(boundary, '\r', boundary_len) || memchr(boundary, '\n', boundary_len))
+	{
+		return -1;
+	}
+
+	memcpy(parser->delimiter, "\r\n--", 4);
+	memcpy(&parser->delimiter[4], boundary, boundary_len);
+	parser->delimiter_len = boundary_len + 4;
+
+	// The first delimiter may start the body without a preceding CRLF
+	parser->state = MULTIPART_STATE_PREAMBLE;
+	parser->match = 2;
+	parser->on_data = on_data;
+	parser->ctx = ctx;
+
+	return 0;
+}
+
+multipart_parser_result_e multipart_parser_feed(multipart_parser_t *parser, const uint8_t *data, size_t len)
+{
+	size_t i = 0;
+	size_t span_start = 0;			// Start of the body bytes in this chunk not yet emitted
+	ptrdiff_t match_start = -1;		// Start of the partial delimiter match, -1 if it began in an earlier chunk
+
+	while (i < len)
+	{
+		uint8_t c = data[i];
+
+		switch (parser->state)
+		{
+			case MULTIPART_STATE_PREAMBLE:
+				if (c == (uint8_t)parser->delimiter[parser->match])
+				{
+					if (++parser->match == parser->delimiter_len)
+					{
+						parser->state = MULTIPART_STATE_DELIMITER_END;
+					}
+				}
+				else
+				{
+					parser->match = (c == '\r') ? 1 : 0;
+				}
+				i++;
+				break;
+
+			case MULTIPART_STATE_DELIMITER_END:
+				if (c == '-')
+				{
+					parser->state = MULTIPART_STATE_CLOSE_DASH;
+				}
+				else if (c == '\r')
+				{
+					parser->state = MULTIPART_STATE_DELIMITER_LF;
+				}
+				else if (c != ' ' && c != '\t')		///> Transport padding is allowed after the boundary
+				{
+					parser->state = MULTIPART_STATE_ERROR;
+				}
+				i++;
+				break;
+
+			case MULTIPART_STATE_CLOSE_DASH:
+				parser->state = (c == '-') ? MULTIPART_STATE_DONE : MULTIPART_STATE_ERROR;
+				i++;
+				break;
+
+			case MULTIPART_STATE_DELIMITER_LF:
+				if (c == '\n')
+				{
+					// The CRLF ending the delimiter line also counts towards the end of an empty header block
+					parser->state = MULTIPART_STATE_HEADERS;
+					parser->header_len = 0;
+					parser->header_crlf = 2;
+				}
+				else
+				{
+					parser->state = MULTIPART_STATE_ERROR;
+				}
+				i++;
+				break;
+
+			case MULTIPART_STATE_HEADERS:
+				if (++parser->header_len > MULTIPART_PARSER_MAX_HEADER_LEN)
+				{
+					parser->state = MULTIPART_STATE_ERROR;
+					break;
+				}
+
+				if (c == (uint8_t)"\r\n\r\n"[parser->header_crlf])
+				{
+					if (++parser->header_crlf == 4)
+					{
+						parser->state = MULTIPART_STATE_BODY;
+						parser->match = 0;
+						span_start = i + 1;
+					}
+				}
+				else
+				{
+					parser->header_crlf = (c == '\r') ? 1 : 0;
+				}
+				i++;
+				break;
+
+			case MULTIPART_STATE_BODY:
+				if (parser->match == 0)
+				{
+					// Fast path, skip straight to the next candidate delimiter
+					const uint8_t *cr = memchr(&data[i], '\r', len - i);
+					if (cr == NULL)
+					{
+						i = len;
+						break;
+					}
+					i = cr - data;
+					match_start = i;
+					parser->match = 1;
+					i++;
+				}
+				else if (c == (uint8_t)parser->delimiter[parser->match])
+				{
+					i++;
+					if (++parser->match == parser->delimiter_len)
+					{
+						// Everything in front of the delimiter belongs to the body
+						size_t span_end = (match_start < 0) ? span_start : (size_t)match_start;
+						if (multipart_parser_emit(parser, &data[span_start], span_end - span_start) != 0)
+						{
+							parser->state = MULTIPART_STATE_ERROR;
+							break;
+						}
+						parser->part_index++;
+						parser->match = 0;
+						parser->state = MULTIPART_STATE_DELIMITER_END;
+					}
+				}
+				else
+				{
+					// Not a delimiter after all, re-emit a match which began in the previous chunk from the delimiter itself
+					if (match_start < 0)
+					{
+						if (multipart_parser_emit(parser, (const uint8_t *)parser->delimiter, parser->match) != 0)
+						{
+							parser->state = MULTIPART_STATE_ERROR;
+							break;
+						}
+						span_start = i;
+					}
+					parser->match = 0;
+					match_start = -1;
+					// Re-examine the current byte, it may start a new delimiter
+				}
+				break;
+
+			case MULTIPART_STATE_DONE:
+				// Ignore the epilogue
+				return MULTIPART_PARSER_DONE;
+
+			case MULTIPART_STATE_ERROR:
+			default:
+				return MULTIPART_PARSER_ERROR;
+		}
+	}
+
+	// Emit the body bytes of this chunk, holding back a partial delimiter match
+	if (parser->state == MULTIPART_STATE_BODY)
+	{
+		size_t span_end = len;
+		if (parser->match > 0)
+		{
+			span_end = (match_start < 0) ? span_start : (size_t)match_start;
+		}
+		if (multipart_parser_emit(parser, &data[span_start], span_end - span_start) != 0)
+		{
+			parser->state = MULTIPART_STATE_ERROR;
+		}
+	}
+
+	switch (parser->state)
+	{
+		case MULTIPART_STATE_DONE:
+			return MULTIPART_PARSER_DONE;
+
+		case MULTIPART_STATE_ERROR:
+			return MULTIPART_PARSER_ERROR;
+
+		default:
+			return MULTIPART_PARSER_OK;
+	}
+}
@@ -0,0 +1,88 @@
+/*
+ * multipart_parser.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef MAIN_MULTIPART_PARSER_H_
+#define MAIN_MULTIPART_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Multipart parser limits
+#define MULTIPART_PARSER_MAX_BOUNDARY_LEN	70			// RFC 2046 boundary limit
+#define MULTIPART_PARSER_MAX_HEADER_LEN		1024		// Upper bound for the headers of one part
+
+/**
+ * Callback receiving the body bytes of the first part.
+ * @param ctx user context passed to multipart_parser_init.
+ * @param data body bytes, points either into the fed buffer or into the parser's delimiter.
+ * @param len number of bytes in data.
+ * @return 0 to continue parsing, any other value aborts with MULTIPART_PARSER_ERROR.
+ */
+typedef int (*multipart_parser_data_cb_t)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * Parser states
+ */
+typedef enum multipart_parser_state
+{
+	MULTIPART_STATE_PREAMBLE = 0,
+	MULTIPART_STATE_DELIMITER_END,
+	MULTIPART_STATE_DELIMITER_LF,
+	MULTIPART_STATE_CLOSE_DASH,
+	MULTIPART_STATE_HEADERS,
+	MULTIPART_STATE_BODY,
+	MULTIPART_STATE_DONE,
+	MULTIPART_STATE_ERROR,
+} multipart_parser_state_e;
+
+/**
+ * Results of multipart_parser_feed
+ */
+typedef enum multipart_parser_result
+{
+	MULTIPART_PARSER_OK = 0,		///> More data is expected
+	MULTIPART_PARSER_DONE,			///> The closing boundary has been parsed
+	MULTIPART_PARSER_ERROR,			///> Malformed body or the callback aborted
+} multipart_parser_result_e;
+
+/**
+ * Incremental multipart/form-data parser.
+ * Only the body of the first part is reported, the part headers and every delimiter are stripped.
+ * Nothing is buffered: body bytes are passed on straight from the fed buffer.
+ */
+typedef struct multipart_parser
+{
+	multipart_parser_state_e state;
+	char delimiter[MULTIPART_PARSER_MAX_BOUNDARY_LEN + 4];	///> "\r\n--" followed by the boundary
+	size_t delimiter_len;
+	size_t match;											///> Delimiter bytes matched so far
+	size_t header_len;										///> Header bytes consumed in the current part
+	uint8_t header_crlf;									///> Bytes of "\r\n\r\n" matched so far
+	int part_index;
+	multipart_parser_data_cb_t on_data;
+	void *ctx;
+} multipart_parser_t;
+
+/**
+ * Initializes the parser from the request's Content-Type header.
+ * @param parser parser instance.
+ * @param content_type value of the Content-Type header, e.g. "multipart/form-data; boundary=xyz".
+ * @param on_data callback receiving the body of the first part.
+ * @param ctx user context passed to on_data.
+ * @return 0 on success, -1 if the header is not multipart or carries no valid boundary.
+ */
+int multipart_parser_init(multipart_parser_t *parser, const char *content_type, multipart_parser_data_cb_t on_data, void *ctx);
+
+/**
+ * Feeds the next chunk of the request body, chunks may be split at any byte.
+ * @param parser parser instance.
+ * @param data received bytes.
+ * @param len number of bytes in data.
+ * @return MULTIPART_PARSER_OK, MULTIPART_PARSER_DONE once the closing boundary is seen or MULTIPART_PARSER_ERROR.
+ */
+multipart_parser_result_e multipart_parser_feed(multipart_parser_t *parser, const uint8_t *data, size_t len);
+
+#endif /* MAIN_MULTIPART_PARSER_H_ */
@@ -0,0 +1,77 @@
+/*
+ * ota_digest.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <string.h>
+
+#include "ota_digest.h"
+
+/**
+ * Value of a hex digit.
+ * @return 0 to 15, -1 if c is not a hex digit.
+ */
+static int ota_digest_nibble(char c)
+{
+	if (c >= '0' && c <= '9')
+	{
+		return c - '0';
+	}
+	if (c >= 'a' && c <= 'f')
+	{
+		return c - 'a' + 10;
+	}
+	if (c >= 'A' && c <= 'F')
+	{
+		return c - 'A' + 10;
+	}
+
+	return -1;
+}
+
+bool ota_digest_from_hex(const char *hex, uint8_t digest[OTA_DIGEST_LEN])
+{
+	if (hex == NULL || strlen(hex) != OTA_DIGEST_HEX_LEN)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < OTA_DIGEST_LEN; i++)
+	{
+		int high = ota_digest_nibble(hex[2 * i]);
+		int low = ota_digest_nibble(hex[2 * i + 1]);
+
+		if (high < 0 || low < 0)
+		{
+			return false;
+		}
+		digest[i] = (high << 4) | low;
+	}
+
+	return true;
+}
+
+void ota_digest_to_hex(const uint8_t digest[OTA_DIGEST_LEN], char hex[OTA_DIGEST_HEX_LEN + 1])
+{
+	static const char digits[] = "0123456789abcdef";
+
+	for (int i = 0; i < OTA_DIGEST_LEN; i++)
+	{
+		hex[2 * i] = digits[digest[i] >> 4];
+		hex[2 * i + 1] = digits[digest[i] & 0x0F];
+	}
+	hex[OTA_DIGEST_HEX_LEN] = '\0';
+}
+
+bool ota_digest_matches(const uint8_t computed[OTA_DIGEST_LEN], const uint8_t expected[OTA_DIGEST_LEN])
+{
+	uint8_t diff = 0;
+
+	for (int i = 0; i < OTA_DIGEST_LEN; i++)
+	{
+		diff |= computed[i] ^ expected[i];
+	}
+
+	return diff == 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * ota_digest.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef MAIN_OTA_DIGEST_H_
+#define MAIN_OTA_DIGEST_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// SHA-256 digest sizes
+#define OTA_DIGEST_LEN			32
+#define OTA_DIGEST_HEX_LEN		(2 * OTA_DIGEST_LEN)
+
+/**
+ * Converts a SHA-256 digest given by a client as hex digits, either case.
+ * Has no hardware dependencies, so it can be tested on the host.
+ * @param hex digest in hex, must be exactly OTA_DIGEST_HEX_LEN digits.
+ * @param digest set to the digest.
+ * @return true if hex is a well formed digest, otherwise false.
+ */
+bool ota_digest_from_hex(const char *hex, uint8_t digest[OTA_DIGEST_LEN]);
+
+/**
+ * Formats a SHA-256 digest as lowercase hex digits.
+ * @param digest digest to format.
+ * @param hex set to the OTA_DIGEST_HEX_LEN digits and a terminating NUL.
+ */
+void ota_digest_to_hex(const uint8_t digest[OTA_DIGEST_LEN], char hex[OTA_DIGEST_HEX_LEN + 1]);
+
+/**
+ * Compares the SHA-256 of a received image with the digest the client gave for it, the last check
+ * before an image may become the boot partition. Takes the same time wherever the digests differ.
+ * @param computed digest of the image as it was written.
+ * @param expected digest given by the client.
+ * @return true if the digests are equal, otherwise false.
+ */
+bool ota_digest_matches(const uint8_t computed[OTA_DIGEST_LEN], const uint8_t expected[OTA_DIGEST_LEN]);
+
+#endif /* MAIN_OTA_DIGEST_H_ */
@@ -0,0 +1,208 @@
+/*
+ * ota_stats.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+#include "ota_stats.h"
+
+// Tag used for ESP serial console messages
+static const char TAG[] = "ota_stats";
+
+// NVS namespace and key of the stored sessions
+static const char ota_stats_nvs_namespace[] = "ota_stats";
+static const char ota_stats_nvs_key[] = "sessions";
+
+// JSON names of the phases
+static const char *const ota_stats_phase_names[OTA_STATS_PHASE_COUNT] = {
+		"socket_wait",
+		"recv",
+		"compare",
+		"erase",
+		"write",
+		"verify",
+		"set_boot",
+};
+
+/**
+ * Sessions stored in NVS, newest first
+ */
+typedef struct ota_stats_history
+{
+	uint32_t count;
+	ota_stats_session_t sessions[OTA_STATS_SESSION_COUNT];
+} ota_stats_history_t;
+
+static ota_stats_history_t ota_stats_history;
+static bool ota_stats_loaded = false;
+
+// Session being collected and its start time
+static ota_stats_session_t ota_stats_current;
+static int64_t ota_stats_start = 0;
+static volatile bool ota_stats_active = false;
+
+/**
+ * Loads the stored sessions from NVS the first time they are needed.
+ */
+static void ota_stats_load(void)
+{
+	nvs_handle_t handle;
+	size_t len = sizeof(ota_stats_history);
+
+	if (ota_stats_loaded)
+	{
+		return;
+	}
+	ota_stats_loaded = true;
+
+	if (nvs_open(ota_stats_nvs_namespace, NVS_READONLY, &handle) == ESP_OK)
+	{
+		// Sessions written by another build may not fit
+		if (nvs_get_blob(handle, ota_stats_nvs_key, &ota_stats_history, &len) != ESP_OK || len != sizeof(ota_stats_history) ||
+			ota_stats_history.count > OTA_STATS_SESSION_COUNT)
+		{
+			memset(&ota_stats_history, 0, sizeof(ota_stats_history));
+		}
+		nvs_close(handle);
+	}
+}
+
+/**
+ * Stores the sessions in NVS.
+ */
+static void ota_stats_save(void)
+{
+	nvs_handle_t handle;
+
+	if (nvs_open(ota_stats_nvs_namespace, NVS_READWRITE, &handle) == ESP_OK)
+	{
+		if (nvs_set_blob(handle, ota_stats_nvs_key, &ota_stats_history, sizeof(ota_stats_history)) == ESP_OK)
+		{
+			nvs_commit(handle);
+		}
+		nvs_close(handle);
+	}
+}
+
+void ota_stats_begin(void)
+{
+	memset(&ota_stats_current, 0, sizeof(ota_stats_current));
+	ota_stats_start = esp_timer_get_time();
+	ota_stats_active = true;
+}
+
+void ota_stats_record(ota_stats_phase_e phase, int64_t start)
+{
+	int64_t elapsed = esp_timer_get_time() - start;
+	int bucket = 0;
+
+	if (!ota_stats_active)
+	{
+		return;
+	}
+
+	// Decade buckets starting at 100 us
+	for (int64_t bound = 100; bucket < OTA_STATS_HISTOGRAM_BUCKETS - 1 && elapsed >= bound; bound *= 10)
+	{
+		bucket++;
+	}
+
+	ota_stats_timing_t *timing = &ota_stats_current.phases[phase];
+	timing->total_us += elapsed;
+	timing->count++;
+	timing->histogram[bucket]++;
+}
+
+void ota_stats_count_sector(bool skipped)
+{
+	if (!ota_stats_active)
+	{
+		return;
+	}
+
+	if (skipped)
+	{
+		ota_stats_current.sectors_skipped++;
+	}
+	else
+	{
+		ota_stats_current.sectors_written++;
+	}
+}
+
+void ota_stats_end(size_t image_size, esp_err_t result)
+{
+	if (!ota_stats_active)
+	{
+		return;
+	}
+	ota_stats_active = false;
+
+	ota_stats_current.image_size = image_size;
+	ota_stats_current.result = result;
+	ota_stats_current.duration_us = esp_timer_get_time() - ota_stats_start;
+
+	ESP_LOGI(TAG, "ota_stats_end: %u bytes in %llu us, recv %llu us, erase %llu us, write %llu us, %lu of %lu sectors skipped", (unsigned)image_size,
+			ota_stats_current.duration_us, ota_stats_current.phases[OTA_STATS_PHASE_RECV].total_us, ota_stats_current.phases[OTA_STATS_PHASE_ERASE].total_us,
+			ota_stats_current.phases[OTA_STATS_PHASE_WRITE].total_us, (unsigned long)ota_stats_current.sectors_skipped,
+			(unsigned long)(ota_stats_current.sectors_skipped + ota_stats_current.sectors_written));
+
+	// Newest first, the oldest session drops out
+	ota_stats_load();
+	memmove(&ota_stats_history.sessions[1], &ota_stats_history.sessions[0], (OTA_STATS_SESSION_COUNT - 1) * sizeof(ota_stats_session_t));
+	ota_stats_history.sessions[0] = ota_stats_current;
+	if (ota_stats_history.count < OTA_STATS_SESSION_COUNT)
+	{
+		ota_stats_history.count++;
+	}
+	ota_stats_save();
+}
+
+int ota_stats_get_json(char *buf, size_t len)
+{
+	size_t pos = 0;
+
+	// Appends to buf, stopping at its end. Once a part is cut off pos is len or more
+#define OTA_STATS_APPEND(...)	do { if (pos < len) { pos += snprintf(&buf[pos], len - pos, __VA_ARGS__); } } while (0)
+
+	ota_stats_load();
+
+	OTA_STATS_APPEND("{\"histogram_bounds_us\":[100,1000,10000,100000,1000000],\"sessions\":[");
+	for (uint32_t i = 0; i < ota_stats_history.count; i++)
+	{
+		const ota_stats_session_t *session = &ota_stats_history.sessions[i];
+		uint32_t sectors = session->sectors_written + session->sectors_skipped;
+
+		OTA_STATS_APPEND("%s{\"image_size\":%lu,\"result\":\"%s\",\"duration_us\":%llu,", (i > 0) ? "," : "",
+				(unsigned long)session->image_size, esp_err_to_name(session->result), session->duration_us);
+		OTA_STATS_APPEND("\"sectors_written\":%lu,\"sectors_skipped\":%lu,\"skip_ratio\":%.3f,\"phases\":{", (unsigned long)session->sectors_written,
+				(unsigned long)session->sectors_skipped, (sectors > 0) ? (double)session->sectors_skipped / sectors : 0.0);
+		for (int phase = 0; phase < OTA_STATS_PHASE_COUNT; phase++)
+		{
+			const ota_stats_timing_t *timing = &session->phases[phase];
+
+			OTA_STATS_APPEND("%s\"%s\":{\"total_us\":%llu,\"count\":%lu,\"histogram\":[", (phase > 0) ? "," : "",
+					ota_stats_phase_names[phase], timing->total_us, (unsigned long)timing->count);
+			for (int bucket = 0; bucket < OTA_STATS_HISTOGRAM_BUCKETS; bucket++)
+			{
+				OTA_STATS_APPEND("%s%lu", (bucket > 0) ? "," : "", (unsigned long)timing->histogram[bucket]);
+			}
+			OTA_STATS_APPEND("]}");
+		}
+		OTA_STATS_APPEND("}}");
+	}
+	OTA_STATS_APPEND("]}");
+
+#undef OTA_STATS_APPEND
+
+	// A cut off document is not JSON anymore
+	return (pos < len) ? (int)pos : -1;
+}
@@ -0,0 +1,99 @@
+/*
+ * ota_stats.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef MAIN_OTA_STATS_H_
+#define MAIN_OTA_STATS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// OTA statistics settings
+#define OTA_STATS_SESSION_COUNT			4			// Number of update sessions kept, newest first
+#define OTA_STATS_HISTOGRAM_BUCKETS		6			// <100 us, <1 ms, <10 ms, <100 ms, <1 s, >=1 s
+
+// Longest parts of the ota_stats_get_json output: the enclosing object, a session without its phases and a phase
+#define OTA_STATS_JSON_HEAD				96
+#define OTA_STATS_JSON_SESSION			256
+#define OTA_STATS_JSON_PHASE			160
+
+// Buffer size needed by ota_stats_get_json
+#define OTA_STATS_JSON_SIZE				(OTA_STATS_JSON_HEAD + OTA_STATS_SESSION_COUNT * (OTA_STATS_JSON_SESSION + OTA_STATS_PHASE_COUNT * OTA_STATS_JSON_PHASE))
+
+/**
+ * Timed phases of an update session
+ */
+typedef enum ota_stats_phase
+{
+	OTA_STATS_PHASE_SOCKET_WAIT = 0,	///> httpd_req_recv calls which timed out without data
+	OTA_STATS_PHASE_RECV,				///> httpd_req_recv calls which returned data
+	OTA_STATS_PHASE_COMPARE,			///> Reading sectors back to compare them with the image
+	OTA_STATS_PHASE_ERASE,				///> Erasing the update partition
+	OTA_STATS_PHASE_WRITE,				///> Programming the update partition
+	OTA_STATS_PHASE_VERIFY,				///> Validating the image, as esp_ota_end does
+	OTA_STATS_PHASE_SET_BOOT,			///> esp_ota_set_boot_partition
+	OTA_STATS_PHASE_COUNT,
+} ota_stats_phase_e;
+
+/**
+ * Timing of one phase
+ */
+typedef struct ota_stats_timing
+{
+	uint64_t total_us;
+	uint32_t count;
+	uint32_t histogram[OTA_STATS_HISTOGRAM_BUCKETS];
+} ota_stats_timing_t;
+
+/**
+ * Statistics of one update session
+ */
+typedef struct ota_stats_session
+{
+	uint32_t image_size;				///> Bytes programmed
+	int32_t result;						///> esp_err_t the session ended with
+	uint64_t duration_us;
+	uint32_t sectors_written;
+	uint32_t sectors_skipped;			///> Sectors which held the image data already
+	ota_stats_timing_t phases[OTA_STATS_PHASE_COUNT];
+} ota_stats_session_t;
+
+/**
+ * Starts collecting the statistics of a new update session.
+ */
+void ota_stats_begin(void);
+
+/**
+ * Adds the time elapsed since start to a phase of the running session, ignored if no session is running.
+ * @param phase phase the time was spent in.
+ * @param start esp_timer_get_time() at the start of the phase.
+ */
+void ota_stats_record(ota_stats_phase_e phase, int64_t start);
+
+/**
+ * Counts a sector of the running session, ignored if no session is running.
+ * @param skipped true if the sector held the data already and was not programmed.
+ */
+void ota_stats_count_sector(bool skipped);
+
+/**
+ * Ends the running session and stores its statistics in NVS, so they survive the restart into the new image.
+ * @param image_size bytes programmed.
+ * @param result outcome of the session.
+ */
+void ota_stats_end(size_t image_size, esp_err_t result);
+
+/**
+ * Formats the statistics of the last sessions as JSON.
+ * @param buf destination, OTA_STATS_JSON_SIZE bytes are enough.
+ * @param len size of buf.
+ * @return length of the JSON string, -1 if it does not fit buf.
+ */
+int ota_stats_get_json(char *buf, size_t len);
+
+#endif /* MAIN_OTA_STATS_H_ */
@@ -0,0 +1,1167 @@
+/*
+ * ota_writer.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_app_desc.h"
+#include "esp_image_format.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mbedtls/sha256.h"
+#include "nvs.h"
+#include "sys/param.h"
+
+#include "bspatch.h"
+#include "heatshrink_decoder.h"
+#include "ota_digest.h"
+#include "ota_stats.h"
+#include "ota_writer.h"
+#include "tasks_common.h"
+
+// Tag used for ESP serial console messages
+static const char TAG[] = "ota_writer";
+
+/**
+ * Pooled buffer passed from the receiver to the writer task.
+ */
+typedef struct ota_writer_buffer
+{
+	size_t len;
+	uint8_t data[OTA_WRITER_BUFFER_SIZE];
+} ota_writer_buffer_t;
+
+// Set by ota_writer_begin before anything is allocated and cleared once the session is finished or aborted,
+// so of two uploads starting at the same time only one gets the session
+static atomic_flag ota_writer_session = ATOMIC_FLAG_INIT;
+
+// Buffer pool, allocated for the duration of an OTA session
+static ota_writer_buffer_t *ota_writer_pool = NULL;
+
+// Buffer currently being filled by the receiver
+static ota_writer_buffer_t *ota_writer_fill_buffer = NULL;
+
+// Queue of empty buffers (writer -> receiver) and of filled buffers (receiver -> writer)
+static QueueHandle_t ota_writer_free_queue = NULL;
+static QueueHandle_t ota_writer_full_queue = NULL;
+
+// Given by the writer task once the end of stream marker has been processed
+static SemaphoreHandle_t ota_writer_done = NULL;
+
+// Update partition of the running session and the number of bytes programmed into it
+static const esp_partition_t *ota_writer_partition = NULL;
+static size_t ota_writer_offset = 0;
+
+// Offset of the next segment header of the image and the number of segments left to walk,
+// the header is collected in segment_header if it straddles two writes
+static size_t ota_writer_segment_next = 0;
+static uint8_t ota_writer_segments_left = 0;
+static esp_image_segment_header_t ota_writer_segment_header;
+static size_t ota_writer_segment_header_len = 0;
+
+// End of the erased area of the update partition and the end of the area the image may occupy
+static size_t ota_writer_erased = 0;
+static size_t ota_writer_erase_limit = 0;
+
+// Area further on which the pre-erase task erased already, past data a failed session left to be reused
+static size_t ota_writer_pre_erased_start = 0;
+static size_t ota_writer_pre_erased_end = 0;
+
+// First error reported by the writer task, ESP_OK while the session is healthy
+static volatile esp_err_t ota_writer_status = ESP_OK;
+
+// Set when the session is cancelled, the writer task then only keeps what is already in flash
+static volatile bool ota_writer_aborting = false;
+
+// Running hash of the programmed image, its final value and the time spent hashing in microseconds
+static mbedtls_sha256_context ota_writer_sha256;
+static uint8_t ota_writer_digest[OTA_DIGEST_LEN];
+static int64_t ota_writer_sha256_time = 0;
+
+// NVS namespace and keys of the resume checkpoint and of the pre-erase progress
+static const char ota_writer_nvs_namespace[] = "ota_writer";
+static const char ota_writer_nvs_key[] = "resume";
+static const char ota_writer_nvs_clean_key[] = "clean";
+
+// Sectors programmed since the last resume checkpoint
+static int ota_writer_checkpoint_sectors = 0;
+
+/**
+ * Resume checkpoint stored in NVS
+ */
+typedef struct ota_writer_checkpoint
+{
+	uint32_t partition_address;				///> Update partition the upload is written to
+	uint32_t image_size;					///> Size of the whole image
+	uint32_t offset;						///> Bytes already programmed, a multiple of the sector size
+	mbedtls_sha256_context sha256;			///> Hash of the programmed bytes
+} ota_writer_checkpoint_t;
+
+/**
+ * Area of the update partition known to be erased, stored in NVS by the pre-erase task
+ */
+typedef struct ota_writer_clean
+{
+	uint32_t partition_address;				///> Update partition the area belongs to
+	uint32_t start;							///> Start of the erased area, at or past the resume checkpoint if there is one
+	uint32_t end;							///> End of the erased area
+} ota_writer_clean_t;
+
+// Pre-erase task handle and the mutex keeping it from erasing while a session starts
+static TaskHandle_t ota_writer_pre_erase_handle = NULL;
+static SemaphoreHandle_t ota_writer_erase_mutex = NULL;
+
+// Set while an OTA session owns the update partition, and for good once it holds an image to be booted
+static volatile bool ota_writer_pre_erase_paused = false;
+
+// Settings of the running session
+static ota_writer_config_t ota_writer_config;
+
+// Decoder used for compressed images
+static heatshrink_decoder_t *ota_writer_decoder = NULL;
+
+// Patch applier used for delta images and the partition holding the image the patch applies to
+static bspatch_t *ota_writer_patch = NULL;
+static const esp_partition_t *ota_writer_running_partition = NULL;
+
+// Collects decoded data until a whole flash sector can be written
+static uint8_t *ota_writer_sector = NULL;
+static size_t ota_writer_sector_len = 0;
+
+// Receives the old contents of a sector to compare them with the new ones
+static uint8_t *ota_writer_compare = NULL;
+
+/**
+ * Reads a blob of the OTA writer namespace from NVS.
+ * @param key NVS key.
+ * @param blob destination.
+ * @param len size of blob, the stored blob has to match.
+ * @return ESP_OK, otherwise ESP_ERR_NOT_FOUND if there is no usable blob.
+ */
+static esp_err_t ota_writer_nvs_load(const char *key, void *blob, size_t len)
+{
+	nvs_handle_t handle;
+	size_t stored_len = len;
+	esp_err_t err;
+
+	if (nvs_open(ota_writer_nvs_namespace, NVS_READONLY, &handle) != ESP_OK)
+	{
+		return ESP_ERR_NOT_FOUND;
+	}
+	err = nvs_get_blob(handle, key, blob, &stored_len);
+	nvs_close(handle);
+
+	// A blob written by another build may not fit
+	if (err != ESP_OK || stored_len != len)
+	{
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	return ESP_OK;
+}
+
+/**
+ * Writes a blob of the OTA writer namespace to NVS.
+ * @param key NVS key.
+ * @param blob data to store.
+ * @param len size of blob.
+ */
+static void ota_writer_nvs_save(const char *key, const void *blob, size_t len)
+{
+	nvs_handle_t handle;
+
+	if (nvs_open(ota_writer_nvs_namespace, NVS_READWRITE, &handle) == ESP_OK)
+	{
+		if (nvs_set_blob(handle, key, blob, len) == ESP_OK)
+		{
+			nvs_commit(handle);
+		}
+		nvs_close(handle);
+	}
+}
+
+/**
+ * Removes a blob of the OTA writer namespace from NVS.
+ * @param key NVS key.
+ */
+static void ota_writer_nvs_erase(const char *key)
+{
+	nvs_handle_t handle;
+
+	if (nvs_open(ota_writer_nvs_namespace, NVS_READWRITE, &handle) == ESP_OK)
+	{
+		nvs_erase_key(handle, key);
+		nvs_commit(handle);
+		nvs_close(handle);
+	}
+}
+
+/**
+ * Loads the resume checkpoint from NVS.
+ * @param checkpoint set to the stored checkpoint.
+ * @return ESP_OK, otherwise ESP_ERR_NOT_FOUND if there is no usable checkpoint.
+ */
+static esp_err_t ota_writer_load_checkpoint(ota_writer_checkpoint_t *checkpoint)
+{
+	return ota_writer_nvs_load(ota_writer_nvs_key, checkpoint, sizeof(*checkpoint));
+}
+
+/**
+ * Stores the progress of the session as resume checkpoint in NVS.
+ */
+static void ota_writer_save_checkpoint(void)
+{
+	ota_writer_checkpoint_t checkpoint = {
+			.partition_address = ota_writer_partition->address,
+			.image_size = ota_writer_config.image_size,
+			.offset = ota_writer_offset,
+	};
+
+	mbedtls_sha256_clone(&checkpoint.sha256, &ota_writer_sha256);
+	ota_writer_nvs_save(ota_writer_nvs_key, &checkpoint, sizeof(checkpoint));
+	ota_writer_checkpoint_sectors = 0;
+}
+
+/**
+ * Removes the resume checkpoint from NVS.
+ */
+static void ota_writer_clear_checkpoint(void)
+{
+	ota_writer_nvs_erase(ota_writer_nvs_key);
+}
+
+/**
+ * Gets the area of the update partition the pre-erase task has erased.
+ * The area starts at the resume checkpoint or further on, as the sectors in front of it hold an interrupted upload.
+ * @param partition update partition.
+ * @param clean set to the erased area, empty if nothing is known to be erased.
+ */
+static void ota_writer_load_clean(const esp_partition_t *partition, ota_writer_clean_t *clean)
+{
+	ota_writer_checkpoint_t checkpoint;
+	uint32_t start = 0;
+
+	if (ota_writer_load_checkpoint(&checkpoint) == ESP_OK && checkpoint.partition_address == partition->address)
+	{
+		start = checkpoint.offset;
+	}
+
+	if (ota_writer_nvs_load(ota_writer_nvs_clean_key, clean, sizeof(*clean)) != ESP_OK ||
+		clean->partition_address != partition->address || clean->start < start || clean->end < clean->start)
+	{
+		clean->partition_address = partition->address;
+		clean->start = start;
+		clean->end = start;
+	}
+}
+
+/**
+ * Pre-erase task, erases the update partition sector by sector while no OTA session is running
+ * so the next update does not have to. Runs at the lowest priority and gives way after every sector.
+ * @param pvParameters parameter which can be passed to the task.
+ */
+static void ota_writer_pre_erase_task(void *pvParameters)
+{
+	const esp_partition_t *partition = esp_ota_get_next_update_partition(NULL);
+	ota_writer_clean_t clean;
+	bool loaded = false;
+
+	for (;;)
+	{
+		bool idle = false;
+
+		xSemaphoreTake(ota_writer_erase_mutex, portMAX_DELAY);
+		if (ota_writer_pre_erase_paused)
+		{
+			// The session changes the partition, start over from NVS afterwards
+			loaded = false;
+		}
+		else
+		{
+			if (!loaded)
+			{
+				ota_writer_load_clean(partition, &clean);
+				loaded = true;
+			}
+
+			if (clean.end < partition->size && esp_partition_erase_range(partition, clean.end, OTA_WRITER_BUFFER_SIZE) == ESP_OK)
+			{
+				clean.end += OTA_WRITER_BUFFER_SIZE;
+
+				// Storing the progress once per flash block keeps NVS wear low
+				if (clean.end % OTA_WRITER_ERASE_SIZE == 0 || clean.end == partition->size)
+				{
+					ota_writer_nvs_save(ota_writer_nvs_clean_key, &clean, sizeof(clean));
+				}
+			}
+			else
+			{
+				idle = true;
+			}
+		}
+		xSemaphoreGive(ota_writer_erase_mutex);
+
+		if (ota_writer_pre_erase_paused || idle)
+		{
+			if (idle && clean.end == partition->size)
+			{
+				ESP_LOGI(TAG, "ota_writer_pre_erase_task: Update partition erased");
+			}
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+			// Woken after a session, which may have run while the task was waiting here
+			loaded = false;
+		}
+		else
+		{
+			vTaskDelay(1);
+		}
+	}
+}
+
+/**
+ * Lets the pre-erase task continue after a session which left the update partition to be reused.
+ * What the session programmed is kept, so retrying the same image finds those sectors matching instead of erased.
+ */
+static void ota_writer_pre_erase_resume(void)
+{
+	if (ota_writer_pre_erase_handle != NULL)
+	{
+		size_t start = (ota_writer_offset + OTA_WRITER_BUFFER_SIZE - 1) / OTA_WRITER_BUFFER_SIZE * OTA_WRITER_BUFFER_SIZE;
+		ota_writer_clean_t clean = {
+				.partition_address = ota_writer_partition->address,
+				.start = start,
+				.end = MAX(start, ota_writer_erased),
+		};
+
+		xSemaphoreTake(ota_writer_erase_mutex, portMAX_DELAY);
+		ota_writer_nvs_save(ota_writer_nvs_clean_key, &clean, sizeof(clean));
+		ota_writer_pre_erase_paused = false;
+		xSemaphoreGive(ota_writer_erase_mutex);
+		xTaskNotifyGive(ota_writer_pre_erase_handle);
+	}
+}
+
+/**
+ * Erases the update partition up to at least end, so erasing is spread over the upload.
+ * @param end offset in the update partition the next write ends at.
+ * @param unit erase granularity, OTA_WRITER_ERASE_SIZE to erase up to the next flash block boundary
+ * or OTA_WRITER_BUFFER_SIZE to erase sector by sector.
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if the image outgrows its declared size or the partition, otherwise an error code.
+ */
+static esp_err_t ota_writer_erase_ahead(size_t end, size_t unit)
+{
+	esp_err_t err;
+
+	while (ota_writer_erased < end)
+	{
+		if (ota_writer_erased >= ota_writer_pre_erased_start && ota_writer_erased < ota_writer_pre_erased_end)
+		{
+			ota_writer_erased = ota_writer_pre_erased_end;
+			continue;
+		}
+
+		if (ota_writer_erased >= ota_writer_erase_limit)
+		{
+			ESP_LOGE(TAG, "ota_writer_erase_ahead: Image does not fit into %u bytes", (unsigned)ota_writer_erase_limit);
+			return ESP_ERR_INVALID_SIZE;
+		}
+
+		// Erasing up to the next block boundary lets the flash driver use the faster block erase from then on
+		size_t len = MIN(unit - ota_writer_erased % unit, ota_writer_erase_limit - ota_writer_erased);
+		if (ota_writer_erased < ota_writer_pre_erased_start)
+		{
+			len = MIN(len, ota_writer_pre_erased_start - ota_writer_erased);
+		}
+		int64_t start = esp_timer_get_time();
+		err = esp_partition_erase_range(ota_writer_partition, ota_writer_erased, len);
+		ota_stats_record(OTA_STATS_PHASE_ERASE, start);
+		if (err != ESP_OK)
+		{
+			ESP_LOGE(TAG, "ota_writer_erase_ahead: esp_partition_erase_range ERROR (%s)", esp_err_to_name(err));
+			return err;
+		}
+		ota_writer_erased += len;
+	}
+
+	return ESP_OK;
+}
+
+/**
+ * Checks the image header, the first segment header and the application description at the start of the image,
+ * so a wrong image is rejected before anything is erased or written.
+ * @param data first bytes of the image.
+ * @param len number of bytes in data.
+ * @return ESP_OK, ESP_ERR_INVALID_VERSION if the image is the running version and the upload is not forced,
+ * otherwise ESP_ERR_OTA_VALIDATE_FAILED.
+ */
+static esp_err_t ota_writer_check_header(const uint8_t *data, size_t len)
+{
+	const size_t app_desc_offset = sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t);
+	esp_image_header_t header;
+	esp_app_desc_t app_desc;
+
+	if (len < app_desc_offset + sizeof(esp_app_desc_t))
+	{
+		ESP_LOGE(TAG, "ota_writer_check_header: Image too short");
+		return ESP_ERR_OTA_VALIDATE_FAILED;
+	}
+	memcpy(&header, data, sizeof(header));
+	memcpy(&app_desc, &data[app_desc_offset], sizeof(app_desc));
+
+	if (header.magic != ESP_IMAGE_HEADER_MAGIC || app_desc.magic_word != ESP_APP_DESC_MAGIC_WORD)
+	{
+		ESP_LOGE(TAG, "ota_writer_check_header: Invalid image magic byte 0x%02x", header.magic);
+		return ESP_ERR_OTA_VALIDATE_FAILED;
+	}
+
+	if (header.chip_id != CONFIG_IDF_FIRMWARE_CHIP_ID)
+	{
+		ESP_LOGE(TAG, "ota_writer_check_header: Image is built for chip id %d, expected %d", header.chip_id, CONFIG_IDF_FIRMWARE_CHIP_ID);
+		return ESP_ERR_OTA_VALIDATE_FAILED;
+	}
+
+	if (header.segment_count == 0 || header.segment_count > ESP_IMAGE_MAX_SEGMENTS)
+	{
+		ESP_LOGE(TAG, "ota_writer_check_header: Invalid segment count %d", header.segment_count);
+		return ESP_ERR_OTA_VALIDATE_FAILED;
+	}
+
+	ESP_LOGI(TAG, "ota_writer_check_header: Image %.32s version %.32s", app_desc.project_name, app_desc.version);
+	if (!ota_writer_config.force && strncmp(app_desc.version, esp_app_get_description()->version, sizeof(app_desc.version)) == 0)
+	{
+		ESP_LOGE(TAG, "ota_writer_check_header: Version %.32s is already running", app_desc.version);
+		return ESP_ERR_INVALID_VERSION;
+	}
+
+	// The segment sizes are checked as the segment headers stream past
+	ota_writer_segment_next = sizeof(esp_image_header_t);
+	ota_writer_segments_left = header.segment_count;
+	ota_writer_segment_header_len = 0;
+
+	return ESP_OK;
+}
+
+/**
+ * Follows the segment headers through the image, so an image which cannot fit into the update partition
+ * is rejected as soon as its segment sizes tell.
+ * @param data image bytes about to be written at the current offset.
+ * @param len number of bytes in data.
+ * @return ESP_OK, otherwise ESP_ERR_INVALID_SIZE.
+ */
+static esp_err_t ota_writer_check_segments(const uint8_t *data, size_t len)
+{
+	const size_t end = ota_writer_offset + len;
+
+	while (ota_writer_segments_left > 0)
+	{
+		size_t at = ota_writer_segment_next + ota_writer_segment_header_len;
+		if (at >= end)
+		{
+			break;
+		}
+
+		size_t chunk = MIN(sizeof(ota_writer_segment_header) - ota_writer_segment_header_len, end - at);
+		memcpy((uint8_t *)&ota_writer_segment_header + ota_writer_segment_header_len, &data[at - ota_writer_offset], chunk);
+		ota_writer_segment_header_len += chunk;
+		if (ota_writer_segment_header_len < sizeof(ota_writer_segment_header))
+		{
+			break;
+		}
+
+		ota_writer_segment_next += sizeof(ota_writer_segment_header) + ota_writer_segment_header.data_len;
+		ota_writer_segment_header_len = 0;
+		ota_writer_segments_left--;
+
+		if (ota_writer_segment_header.data_len > ota_writer_partition->size || ota_writer_segment_next > ota_writer_partition->size)
+		{
+			ESP_LOGE(TAG, "ota_writer_check_segments: Image does not fit into the update partition");
+			return ESP_ERR_INVALID_SIZE;
+		}
+	}
+
+	return ESP_OK;
+}
+
+/**
+ * Checks whether the update partition already holds the data at the current offset.
+ * @param data image bytes about to be written.
+ * @param len number of bytes in data, at most a sector.
+ * @return true if the data is in flash already, otherwise false.
+ */
+static bool ota_writer_sector_matches(const uint8_t *data, size_t len)
+{
+	int64_t start = esp_timer_get_time();
+	bool match = (esp_partition_read(ota_writer_partition, ota_writer_offset, ota_writer_compare, len) == ESP_OK && memcmp(ota_writer_compare, data, len) == 0);
+	ota_stats_record(OTA_STATS_PHASE_COMPARE, start);
+
+	return match;
+}
+
+/**
+ * Writes image data to the update partition and adds it to the running hash.
+ * Sectors which are not erased yet are compared with the data first and left alone if they hold it already,
+ * e.g. when the same image is flashed again or an interrupted upload is retried.
+ * @param data image bytes, a whole flash sector except at the end of the image.
+ * @param len number of bytes in data.
+ * @return ESP_OK, otherwise an error code.
+ */
+static esp_err_t ota_writer_flash(const uint8_t *data, size_t len)
+{
+	esp_err_t err;
+
+	// A wrong image is rejected on its first sector, before anything is erased
+	if (ota_writer_offset == 0 && (err = ota_writer_check_header(data, len)) != ESP_OK)
+	{
+		return err;
+	}
+
+	if ((err = ota_writer_check_segments(data, len)) != ESP_OK)
+	{
+		return err;
+	}
+
+	if (ota_writer_offset >= ota_writer_erased && ota_writer_sector_matches(data, len))
+	{
+		// Nothing to erase or write, the sector counts as done
+		ota_writer_erased = ota_writer_offset + len;
+		ota_stats_count_sector(true);
+	}
+	else
+	{
+		// A block whose first sector differs is erased as a whole, within a block which started out matching
+		// only the differing sectors are erased so the matching ones further on are kept
+		size_t unit = (ota_writer_offset % OTA_WRITER_ERASE_SIZE == 0) ? OTA_WRITER_ERASE_SIZE : OTA_WRITER_BUFFER_SIZE;
+		if ((err = ota_writer_erase_ahead(ota_writer_offset + len, unit)) != ESP_OK)
+		{
+			return err;
+		}
+
+		int64_t start = esp_timer_get_time();
+		err = esp_partition_write(ota_writer_partition, ota_writer_offset, data, len);
+		ota_stats_record(OTA_STATS_PHASE_WRITE, start);
+		if (err != ESP_OK)
+		{
+			ESP_LOGE(TAG, "ota_writer_flash: esp_partition_write ERROR (%s)", esp_err_to_name(err));
+			return err;
+		}
+		ota_stats_count_sector(false);
+	}
+
+	// Hashing the data as it is written saves reading the partition back
+	int64_t start = esp_timer_get_time();
+	mbedtls_sha256_update(&ota_writer_sha256, data, len);
+	ota_writer_sha256_time += esp_timer_get_time() - start;
+	ota_writer_offset += len;
+
+	if (ota_writer_config.resumable && ++ota_writer_checkpoint_sectors == OTA_WRITER_CHECKPOINT_SECTORS)
+	{
+		ota_writer_save_checkpoint();
+	}
+
+	return ESP_OK;
+}
+
+/**
+ * Collects image data into whole flash sectors before writing them.
+ * Data arriving in whole sectors is written straight from the caller's buffer.
+ * Also used as the output callback of the decoder.
+ * @param ctx unused.
+ * @param data image bytes.
+ * @param len number of bytes in data.
+ * @return ESP_OK, otherwise the error returned while writing to flash.
+ */
+static int ota_writer_program(void *ctx, const uint8_t *data, size_t len)
+{
+	esp_err_t err;
+
+	while (len > 0)
+	{
+		if (ota_writer_sector_len == 0 && len >= OTA_WRITER_BUFFER_SIZE)
+		{
+			if ((err = ota_writer_flash(data, OTA_WRITER_BUFFER_SIZE)) != ESP_OK)
+			{
+				return err;
+			}
+			data += OTA_WRITER_BUFFER_SIZE;
+			len -= OTA_WRITER_BUFFER_SIZE;
+			continue;
+		}
+
+		size_t chunk = MIN(len, OTA_WRITER_BUFFER_SIZE - ota_writer_sector_len);
+		memcpy(&ota_writer_sector[ota_writer_sector_len], data, chunk);
+		ota_writer_sector_len += chunk;
+		data += chunk;
+		len -= chunk;
+
+		if (ota_writer_sector_len == OTA_WRITER_BUFFER_SIZE)
+		{
+			ota_writer_sector_len = 0;
+			if ((err = ota_writer_flash(ota_writer_sector, OTA_WRITER_BUFFER_SIZE)) != ESP_OK)
+			{
+				return err;
+			}
+		}
+	}
+
+	return ESP_OK;
+}
+
+/**
+ * Reads the running image for the patch applier.
+ * @param ctx unused.
+ * @param offset offset in the running image.
+ * @param buf destination buffer.
+ * @param len number of bytes to read.
+ * @return ESP_OK, otherwise the error returned by esp_partition_read.
+ */
+static int ota_writer_read_running(void *ctx, size_t offset, uint8_t *buf, size_t len)
+{
+	return esp_partition_read(ota_writer_running_partition, offset, buf, len);
+}
+
+/**
+ * Receives the decompressed upload, rebuilds the image from it for delta updates and programs the result.
+ * Also used as the output callback of the decoder.
+ * @param ctx unused.
+ * @param data decompressed bytes.
+ * @param len number of bytes in data.
+ * @return ESP_OK, otherwise an error code.
+ */
+static int ota_writer_decoded(void *ctx, const uint8_t *data, size_t len)
+{
+	if (ota_writer_config.delta)
+	{
+		return bspatch_feed(ota_writer_patch, data, len);
+	}
+
+	return ota_writer_program(NULL, data, len);
+}
+
+/**
+ * Decodes a received buffer according to the settings of the session and programs the result.
+ * @param data received bytes.
+ * @param len number of bytes in data.
+ * @return ESP_OK, otherwise an error code.
+ */
+static esp_err_t ota_writer_process(const uint8_t *data, size_t len)
+{
+	switch (ota_writer_config.encoding)
+	{
+		case OTA_WRITER_ENCODING_HEATSHRINK:
+			return heatshrink_decoder_feed(ota_writer_decoder, data, len);
+
+		case OTA_WRITER_ENCODING_NONE:
+		default:
+			return ota_writer_decoded(NULL, data, len);
+	}
+}
+
+/**
+ * Programs everything still held by the decoder, the patch applier and the sector buffer at the end of the stream.
+ * @return ESP_OK, otherwise an error code.
+ */
+static esp_err_t ota_writer_end_of_stream(void)
+{
+	esp_err_t err = ESP_OK;
+
+	if (ota_writer_config.encoding == OTA_WRITER_ENCODING_HEATSHRINK)
+	{
+		err = heatshrink_decoder_finish(ota_writer_decoder);
+	}
+
+	if (err == ESP_OK && ota_writer_config.delta && bspatch_finish(ota_writer_patch) != 0)
+	{
+		ESP_LOGE(TAG, "ota_writer_end_of_stream: Patch is truncated");
+		err = ESP_ERR_INVALID_SIZE;
+	}
+
+	if (err == ESP_OK && ota_writer_sector_len > 0)
+	{
+		err = ota_writer_flash(ota_writer_sector, ota_writer_sector_len);
+		ota_writer_sector_len = 0;
+	}
+
+	return err;
+}
+
+/**
+ * Writer task, opens the update partition and programs the buffers in the order they were received.
+ * A NULL buffer marks the end of the stream.
+ * @param pvParameters parameter which can be passed to the task.
+ */
+static void ota_writer_task(void *pvParameters)
+{
+	ota_writer_buffer_t *buf;
+	esp_err_t err;
+
+	// The partition is erased just ahead of the data, so the first sector is accepted right away
+	ESP_LOGI(TAG, "ota_writer_task: Writing to partition subtype %d at offset 0x%lx", ota_writer_partition->subtype, ota_writer_partition->address + ota_writer_offset);
+
+	for (;;)
+	{
+		xQueueReceive(ota_writer_full_queue, &buf, portMAX_DELAY);
+		if (buf == NULL)
+		{
+			break;
+		}
+
+		// After an error keep recycling the buffers so the receiver never blocks
+		if (ota_writer_status == ESP_OK && (err = ota_writer_process(buf->data, buf->len)) != ESP_OK)
+		{
+			ota_writer_status = err;
+		}
+
+		xQueueSend(ota_writer_free_queue, &buf, portMAX_DELAY);
+	}
+
+	if (ota_writer_aborting)
+	{
+		// Keep what is already in flash so the upload can be continued
+		if (ota_writer_status == ESP_OK && ota_writer_config.resumable)
+		{
+			ota_writer_save_checkpoint();
+			ESP_LOGI(TAG, "ota_writer_task: Upload can be resumed at offset %u", (unsigned)ota_writer_offset);
+		}
+	}
+	else if (ota_writer_status == ESP_OK && (err = ota_writer_end_of_stream()) != ESP_OK)
+	{
+		ota_writer_status = err;
+	}
+	else if (ota_writer_status == ESP_OK)
+	{
+		mbedtls_sha256_finish(&ota_writer_sha256, ota_writer_digest);
+	}
+
+	xSemaphoreGive(ota_writer_done);
+	vTaskDelete(NULL);
+}
+
+/**
+ * Hands the partially filled buffer over, sends the end of stream marker and waits for the writer task to exit.
+ * Releases the pipeline resources afterwards.
+ * @param abort true to drop the partially filled buffer and everything not making up a whole sector.
+ * @return ESP_OK if every byte was written, otherwise the error reported by the writer task.
+ */
+static esp_err_t ota_writer_drain(bool abort)
+{
+	ota_writer_buffer_t *end_marker = NULL;
+
+	ota_writer_aborting = abort;
+	if (!abort && ota_writer_fill_buffer != NULL && ota_writer_fill_buffer->len > 0)
+	{
+		xQueueSend(ota_writer_full_queue, &ota_writer_fill_buffer, portMAX_DELAY);
+		ota_writer_fill_buffer = NULL;
+	}
+	xQueueSend(ota_writer_full_queue, &end_marker, portMAX_DELAY);
+	xSemaphoreTake(ota_writer_done, portMAX_DELAY);
+
+	vQueueDelete(ota_writer_free_queue);
+	vQueueDelete(ota_writer_full_queue);
+	vSemaphoreDelete(ota_writer_done);
+	free(ota_writer_pool);
+	free(ota_writer_sector);
+	free(ota_writer_compare);
+	free(ota_writer_decoder);
+	free(ota_writer_patch);
+	ota_writer_free_queue = NULL;
+	ota_writer_full_queue = NULL;
+	ota_writer_done = NULL;
+	ota_writer_pool = NULL;
+	ota_writer_sector = NULL;
+	ota_writer_compare = NULL;
+	ota_writer_decoder = NULL;
+	ota_writer_patch = NULL;
+	ota_writer_fill_buffer = NULL;
+	mbedtls_sha256_free(&ota_writer_sha256);
+
+	return ota_writer_status;
+}
+
+/**
+ * Sets up the session claimed by ota_writer_begin and starts the writer task.
+ * @param config settings of the session.
+ * @return ESP_OK if the session was started, otherwise an error code.
+ */
+static esp_err_t ota_writer_open(const ota_writer_config_t *config)
+{
+	size_t running_image_len = 0;
+
+	ota_writer_partition = esp_ota_get_next_update_partition(NULL);
+	if (ota_writer_partition == NULL)
+	{
+		ESP_LOGE(TAG, "ota_writer_begin: No update partition found");
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	// Only uploads written to flash as they arrive can be continued
+	if ((config->resumable || config->resume_offset > 0) && (config->encoding != OTA_WRITER_ENCODING_NONE || config->delta || config->image_size == 0))
+	{
+		ESP_LOGE(TAG, "ota_writer_begin: Only plain images of known size can be resumed");
+		return ESP_ERR_NOT_SUPPORTED;
+	}
+
+	if (config->image_size > ota_writer_partition->size)
+	{
+		ESP_LOGE(TAG, "ota_writer_begin: Image of %u bytes does not fit into the update partition", (unsigned)config->image_size);
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	mbedtls_sha256_init(&ota_writer_sha256);
+	mbedtls_sha256_starts(&ota_writer_sha256, 0);
+	ota_writer_offset = 0;
+
+	if (config->resume_offset > 0)
+	{
+		ota_writer_checkpoint_t checkpoint;
+
+		if (ota_writer_load_checkpoint(&checkpoint) != ESP_OK ||
+			checkpoint.partition_address != ota_writer_partition->address ||
+			checkpoint.image_size != config->image_size ||
+			checkpoint.offset != config->resume_offset)
+		{
+			ESP_LOGE(TAG, "ota_writer_begin: No checkpoint to resume at offset %u", (unsigned)config->resume_offset);
+			mbedtls_sha256_free(&ota_writer_sha256);
+			return ESP_ERR_INVALID_ARG;
+		}
+
+		mbedtls_sha256_clone(&ota_writer_sha256, &checkpoint.sha256);
+		ota_writer_offset = checkpoint.offset;
+		ESP_LOGI(TAG, "ota_writer_begin: Resuming upload at offset %u of %u", (unsigned)ota_writer_offset, (unsigned)config->image_size);
+	}
+	else
+	{
+		// A new upload overwrites the partition, so any interrupted one cannot be continued anymore
+		ota_writer_clear_checkpoint();
+	}
+
+	// Only the sectors the image will occupy are erased. Sectors past a resume checkpoint
+	// may have been written before the interruption, so erasing starts over at the checkpoint.
+	ota_writer_erased = ota_writer_offset;
+
+	ota_writer_erase_limit = (config->image_size > 0) ?
+			(config->image_size + OTA_WRITER_BUFFER_SIZE - 1) / OTA_WRITER_BUFFER_SIZE * OTA_WRITER_BUFFER_SIZE : ota_writer_partition->size;
+
+	// A patch applies to the exact image which is running now
+	if (config->delta)
+	{
+		esp_image_metadata_t metadata;
+
+		ota_writer_running_partition = esp_ota_get_running_partition();
+		const esp_partition_pos_t running_pos = {
+				.offset = ota_writer_running_partition->address,
+				.size = ota_writer_running_partition->size,
+		};
+		if (esp_image_get_metadata(&running_pos, &metadata) != ESP_OK)
+		{
+			ESP_LOGE(TAG, "ota_writer_begin: Running image is unreadable, cannot apply a patch");
+			mbedtls_sha256_free(&ota_writer_sha256);
+			return ESP_ERR_IMAGE_INVALID;
+		}
+		running_image_len = metadata.image_len;
+	}
+
+	ota_writer_pool = malloc(OTA_WRITER_BUFFER_COUNT * sizeof(ota_writer_buffer_t));
+	ota_writer_sector = malloc(OTA_WRITER_BUFFER_SIZE);
+	ota_writer_compare = malloc(OTA_WRITER_BUFFER_SIZE);
+	ota_writer_free_queue = xQueueCreate(OTA_WRITER_BUFFER_COUNT, sizeof(ota_writer_buffer_t *));
+	ota_writer_full_queue = xQueueCreate(OTA_WRITER_BUFFER_COUNT + 1, sizeof(ota_writer_buffer_t *));
+	ota_writer_done = xSemaphoreCreateBinary();
+	if (config->encoding == OTA_WRITER_ENCODING_HEATSHRINK)
+	{
+		ota_writer_decoder = malloc(sizeof(heatshrink_decoder_t));
+	}
+	if (config->delta)
+	{
+		ota_writer_patch = malloc(sizeof(bspatch_t));
+	}
+	if (ota_writer_pool == NULL || ota_writer_sector == NULL || ota_writer_compare == NULL || ota_writer_free_queue == NULL || ota_writer_full_queue == NULL || ota_writer_done == NULL ||
+		(config->encoding == OTA_WRITER_ENCODING_HEATSHRINK && ota_writer_decoder == NULL) || (config->delta && ota_writer_patch == NULL))
+	{
+		ESP_LOGE(TAG, "ota_writer_begin: Out of memory");
+		if (ota_writer_free_queue) { vQueueDelete(ota_writer_free_queue); ota_writer_free_queue = NULL; }
+		if (ota_writer_full_queue) { vQueueDelete(ota_writer_full_queue); ota_writer_full_queue = NULL; }
+		if (ota_writer_done) { vSemaphoreDelete(ota_writer_done); ota_writer_done = NULL; }
+		free(ota_writer_pool);
+		free(ota_writer_sector);
+		free(ota_writer_compare);
+		free(ota_writer_decoder);
+		free(ota_writer_patch);
+		ota_writer_pool = NULL;
+		ota_writer_sector = NULL;
+		ota_writer_compare = NULL;
+		ota_writer_decoder = NULL;
+		ota_writer_patch = NULL;
+		mbedtls_sha256_free(&ota_writer_sha256);
+		return ESP_ERR_NO_MEM;
+	}
+
+	ota_writer_config = *config;
+	ota_writer_sector_len = 0;
+	if (config->encoding == OTA_WRITER_ENCODING_HEATSHRINK)
+	{
+		ESP_LOGI(TAG, "ota_writer_begin: Decompressing heatshrink image");
+		heatshrink_decoder_init(ota_writer_decoder, ota_writer_decoded, NULL);
+	}
+	if (config->delta)
+	{
+		ESP_LOGI(TAG, "ota_writer_begin: Applying patch against the running image (%u bytes)", (unsigned)running_image_len);
+		bspatch_init(ota_writer_patch, running_image_len, ota_writer_read_running, ota_writer_program, NULL);
+	}
+
+	// Every buffer starts out empty
+	for (int i = 0; i < OTA_WRITER_BUFFER_COUNT; i++)
+	{
+		ota_writer_buffer_t *buf = &ota_writer_pool[i];
+		xQueueSend(ota_writer_free_queue, &buf, 0);
+	}
+
+	// Skip what the pre-erase task has erased already, the session is going to dirty that area
+	ota_writer_pre_erased_start = 0;
+	ota_writer_pre_erased_end = 0;
+	if (ota_writer_erase_mutex != NULL)
+	{
+		ota_writer_clean_t clean;
+
+		xSemaphoreTake(ota_writer_erase_mutex, portMAX_DELAY);
+		ota_writer_pre_erase_paused = true;
+		ota_writer_load_clean(ota_writer_partition, &clean);
+		if (clean.start <= ota_writer_offset && clean.end > ota_writer_offset)
+		{
+			ota_writer_erased = clean.end;
+			ESP_LOGI(TAG, "ota_writer_begin: %u bytes already erased", (unsigned)(clean.end - ota_writer_offset));
+		}
+		else if (clean.start > ota_writer_offset && clean.end > clean.start)
+		{
+			// Sectors in front of the area still hold a failed upload, they are compared before being erased
+			ota_writer_pre_erased_start = clean.start;
+			ota_writer_pre_erased_end = clean.end;
+			ESP_LOGI(TAG, "ota_writer_begin: %u bytes already erased from offset %u", (unsigned)(clean.end - clean.start), (unsigned)clean.start);
+		}
+		ota_writer_nvs_erase(ota_writer_nvs_clean_key);
+		xSemaphoreGive(ota_writer_erase_mutex);
+	}
+
+	ota_writer_fill_buffer = NULL;
+	ota_writer_checkpoint_sectors = 0;
+	ota_writer_segments_left = 0;
+	ota_writer_sha256_time = 0;
+	ota_writer_aborting = false;
+	ota_writer_status = ESP_OK;
+	ota_stats_begin();
+
+	xTaskCreatePinnedToCore(&ota_writer_task, "ota_writer_task", OTA_WRITER_TASK_STACK_SIZE, NULL, OTA_WRITER_TASK_PRIORITY, NULL, OTA_WRITER_TASK_CORE_ID);
+
+	return ESP_OK;
+}
+
+esp_err_t ota_writer_begin(const ota_writer_config_t *config)
+{
+	// Claim the session before looking at or allocating anything
+	if (atomic_flag_test_and_set(&ota_writer_session))
+	{
+		ESP_LOGE(TAG, "ota_writer_begin: OTA session already running");
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	esp_err_t err = ota_writer_open(config);
+	if (err != ESP_OK)
+	{
+		atomic_flag_clear(&ota_writer_session);
+	}
+
+	return err;
+}
+
+uint8_t *ota_writer_get_buffer(size_t *free_len)
+{
+	if (ota_writer_fill_buffer == NULL)
+	{
+		xQueueReceive(ota_writer_free_queue, &ota_writer_fill_buffer, portMAX_DELAY);
+		ota_writer_fill_buffer->len = 0;
+	}
+
+	*free_len = OTA_WRITER_BUFFER_SIZE - ota_writer_fill_buffer->len;
+
+	return &ota_writer_fill_buffer->data[ota_writer_fill_buffer->len];
+}
+
+esp_err_t ota_writer_commit(size_t len)
+{
+	ota_writer_fill_buffer->len += len;
+
+	// Hand full buffers over to the writer task, so every flash write covers a whole sector
+	if (ota_writer_fill_buffer->len == OTA_WRITER_BUFFER_SIZE)
+	{
+		xQueueSend(ota_writer_full_queue, &ota_writer_fill_buffer, portMAX_DELAY);
+		ota_writer_fill_buffer = NULL;
+	}
+
+	return ota_writer_status;
+}
+
+esp_err_t ota_writer_write(const void *data, size_t len)
+{
+	const uint8_t *src = data;
+
+	while (len > 0 && ota_writer_status == ESP_OK)
+	{
+		size_t free_len;
+		uint8_t *dst = ota_writer_get_buffer(&free_len);
+		size_t chunk = MIN(len, free_len);
+
+		memcpy(dst, src, chunk);
+		ota_writer_commit(chunk);
+		src += chunk;
+		len -= chunk;
+	}
+
+	return ota_writer_status;
+}
+
+/**
+ * Flushes the pipeline, validates the image and sets the update partition as the boot partition.
+ * @return ESP_OK if the new image will be booted on the next restart, otherwise an error code.
+ */
+static esp_err_t ota_writer_complete(void)
+{
+	esp_image_metadata_t metadata;
+	esp_err_t err = ota_writer_drain(false);
+
+	// The upload is complete, whatever the outcome there is nothing left to resume
+	ota_writer_clear_checkpoint();
+
+	if (err != ESP_OK)
+	{
+		return err;
+	}
+
+#ifdef CONFIG_MBEDTLS_HARDWARE_SHA
+	ESP_LOGI(TAG, "ota_writer_finish: SHA-256 (hardware) of %u bytes took %lld us", (unsigned)ota_writer_offset, ota_writer_sha256_time);
+#else
+	ESP_LOGI(TAG, "ota_writer_finish: SHA-256 (software) of %u bytes took %lld us", (unsigned)ota_writer_offset, ota_writer_sha256_time);
+#endif
+
+	// A corrupted upload must never become the boot partition
+	if (ota_writer_config.verify_sha256 && !ota_digest_matches(ota_writer_digest, ota_writer_config.sha256))
+	{
+		ESP_LOGE(TAG, "ota_writer_finish: Image SHA-256 mismatch, cancelling OTA");
+		return ESP_ERR_INVALID_CRC;
+	}
+
+	// Same validation as esp_ota_end
+	const esp_partition_pos_t update_pos = {
+			.offset = ota_writer_partition->address,
+			.size = ota_writer_partition->size,
+	};
+	int64_t start = esp_timer_get_time();
+	err = esp_image_verify(ESP_IMAGE_VERIFY, &update_pos, &metadata);
+	ota_stats_record(OTA_STATS_PHASE_VERIFY, start);
+	if (err != ESP_OK)
+	{
+		ESP_LOGI(TAG, "ota_writer_finish: Image validation ERROR!!!");
+		return ESP_ERR_OTA_VALIDATE_FAILED;
+	}
+
+	// Lets update the partition
+	start = esp_timer_get_time();
+	err = esp_ota_set_boot_partition(ota_writer_partition);
+	ota_stats_record(OTA_STATS_PHASE_SET_BOOT, start);
+	if (err != ESP_OK)
+	{
+		ESP_LOGI(TAG, "ota_writer_finish: FLASHED ERROR!!!");
+		return err;
+	}
+
+	const esp_partition_t *boot_partition = esp_ota_get_boot_partition();
+	ESP_LOGI(TAG, "ota_writer_finish: Next boot partition subtype %d at offset 0x%lx", boot_partition->subtype, boot_partition->address);
+
+	return ESP_OK;
+}
+
+esp_err_t ota_writer_finish(void)
+{
+	if (ota_writer_pool == NULL)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	// Until the restart the update partition holds the image to be booted, only a failed update may be erased
+	esp_err_t err = ota_writer_complete();
+	if (err != ESP_OK)
+	{
+		ota_writer_pre_erase_resume();
+	}
+	ota_stats_end(ota_writer_offset, err);
+	atomic_flag_clear(&ota_writer_session);
+
+	return err;
+}
+
+void ota_writer_abort(void)
+{
+	if (ota_writer_pool == NULL)
+	{
+		return;
+	}
+
+	esp_err_t err = ota_writer_drain(true);
+	ota_writer_pre_erase_resume();
+	ota_stats_end(ota_writer_offset, (err != ESP_OK) ? err : ESP_FAIL);
+	atomic_flag_clear(&ota_writer_session);
+	ESP_LOGI(TAG, "ota_writer_abort: OTA session cancelled");
+}
+
+void ota_writer_start_pre_erase(void)
+{
+	esp_ota_img_states_t state;
+
+	// With rollback the other partition holds the image to fall back to until this one is confirmed
+	if (esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY)
+	{
+		ESP_LOGI(TAG, "ota_writer_start_pre_erase: Running image not confirmed yet, not erasing");
+		return;
+	}
+
+	if (ota_writer_pre_erase_handle != NULL || esp_ota_get_next_update_partition(NULL) == NULL)
+	{
+		return;
+	}
+
+	if ((ota_writer_erase_mutex = xSemaphoreCreateMutex()) == NULL)
+	{
+		return;
+	}
+
+	xTaskCreatePinnedToCore(&ota_writer_pre_erase_task, "ota_pre_erase_task", OTA_PRE_ERASE_TASK_STACK_SIZE, NULL, OTA_PRE_ERASE_TASK_PRIORITY, &ota_writer_pre_erase_handle, OTA_PRE_ERASE_TASK_CORE_ID);
+}
+
+esp_err_t ota_writer_get_resume_point(ota_writer_resume_point_t *point)
+{
+	ota_writer_checkpoint_t checkpoint;
+	const esp_partition_t *update_partition = esp_ota_get_next_update_partition(NULL);
+
+	memset(point, 0, sizeof(*point));
+
+	if (update_partition == NULL || ota_writer_load_checkpoint(&checkpoint) != ESP_OK || checkpoint.partition_address != update_partition->address)
+	{
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	point->offset = checkpoint.offset;
+	point->image_size = checkpoint.image_size;
+	mbedtls_sha256_finish(&checkpoint.sha256, point->sha256);
+	mbedtls_sha256_free(&checkpoint.sha256);
+
+	return ESP_OK;
+}
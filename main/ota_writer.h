@@ -0,0 +1,122 @@
+/*
+ * ota_writer.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef MAIN_OTA_WRITER_H_
+#define MAIN_OTA_WRITER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// OTA writer pipeline settings, the buffer size and count can be overridden by the build e.g. to benchmark them
+#ifndef OTA_WRITER_BUFFER_SIZE
+#define OTA_WRITER_BUFFER_SIZE		4096		// Size of one pooled buffer, a multiple of the flash sector size
+#endif
+#ifndef OTA_WRITER_BUFFER_COUNT
+#define OTA_WRITER_BUFFER_COUNT		4			// Number of pooled buffers in the ring
+#endif
+#define OTA_WRITER_CHECKPOINT_SECTORS	16		// Sectors programmed between two resume checkpoints in NVS
+#define OTA_WRITER_ERASE_SIZE		65536		// Flash erased ahead of the write position at a time (one flash block)
+
+/**
+ * Encodings of the uploaded image
+ */
+typedef enum ota_writer_encoding
+{
+	OTA_WRITER_ENCODING_NONE = 0,		///> Plain .bin image
+	OTA_WRITER_ENCODING_HEATSHRINK,		///> Image compressed with heatshrink, see heatshrink_decoder.h
+} ota_writer_encoding_e;
+
+/**
+ * Settings of an OTA session
+ */
+typedef struct ota_writer_config
+{
+	ota_writer_encoding_e encoding;		///> Encoding of the upload
+	bool delta;							///> Upload is a bsdiff patch against the running image, see bspatch.h
+	size_t image_size;					///> Size of the whole image, 0 if unknown. Only this much of the partition is erased
+	size_t resume_offset;				///> Offset an interrupted upload continues at, 0 for a new upload
+	bool resumable;						///> Store checkpoints so the upload can be continued if interrupted
+	bool force;							///> Accept an image of the version which is running
+	bool verify_sha256;					///> Check the programmed image against sha256 before it is booted
+	uint8_t sha256[32];					///> Expected SHA-256 of the image, after decompression and patching
+} ota_writer_config_t;
+
+/**
+ * Point an interrupted upload can be continued at
+ */
+typedef struct ota_writer_resume_point
+{
+	size_t offset;						///> Bytes already programmed
+	size_t image_size;					///> Size of the whole image
+	uint8_t sha256[32];					///> SHA-256 of the first offset bytes of the image
+} ota_writer_resume_point_t;
+
+/**
+ * Starts a new OTA session.
+ * Allocates the buffer pool and creates the writer task which opens the next update partition
+ * and programs every buffer handed over by the receiver, decompressing it and applying it as a patch first if needed.
+ * Only one session runs at a time, it belongs to the caller which got ESP_OK until it calls ota_writer_finish or ota_writer_abort.
+ * @param config settings of the session.
+ * @return ESP_OK if the session was started, ESP_ERR_INVALID_STATE if another session is running,
+ * ESP_ERR_INVALID_ARG if there is no checkpoint to resume at config->resume_offset, otherwise an error code.
+ */
+esp_err_t ota_writer_begin(const ota_writer_config_t *config);
+
+/**
+ * Copies image data into the pipeline, handing full buffers over to the writer task.
+ * Blocks only when every pooled buffer is waiting to be written to flash.
+ * @param data image bytes.
+ * @param len number of bytes in data.
+ * @return ESP_OK, otherwise the error reported by the writer task.
+ */
+esp_err_t ota_writer_write(const void *data, size_t len);
+
+/**
+ * Gets the free space of the buffer currently being filled, so the receiver can read straight into it.
+ * Blocks only when every pooled buffer is waiting to be written to flash.
+ * @param free_len set to the number of bytes which can be stored at the returned address.
+ * @return address the next image bytes should be stored at.
+ */
+uint8_t *ota_writer_get_buffer(size_t *free_len);
+
+/**
+ * Commits bytes stored at the address returned by ota_writer_get_buffer.
+ * The buffer is handed over to the writer task as soon as it holds a whole flash sector.
+ * @param len number of bytes stored, at most the free_len reported by ota_writer_get_buffer.
+ * @return ESP_OK, otherwise the error reported by the writer task.
+ */
+esp_err_t ota_writer_commit(size_t len);
+
+/**
+ * Flushes the pipeline, validates the image and sets the update partition as the boot partition.
+ * @return ESP_OK if the new image will be booted on the next restart, ESP_ERR_INVALID_CRC if it does not match
+ * the expected SHA-256, otherwise an error code.
+ */
+esp_err_t ota_writer_finish(void);
+
+/**
+ * Cancels the running OTA session and releases its resources.
+ * Whole sectors already received stay in flash, resumable sessions store a checkpoint to continue from.
+ */
+void ota_writer_abort(void);
+
+/**
+ * Starts the pre-erase task, which erases the update partition in the background while no OTA session is running.
+ * Its progress is kept in NVS, so the next session only erases what is left. Call once NVS is initialized.
+ */
+void ota_writer_start_pre_erase(void);
+
+/**
+ * Gets the point an interrupted resumable upload can be continued at.
+ * @param point set to the resume point.
+ * @return ESP_OK, otherwise ESP_ERR_NOT_FOUND if there is no upload to resume.
+ */
+esp_err_t ota_writer_get_resume_point(ota_writer_resume_point_t *point);
+
+#endif /* MAIN_OTA_WRITER_H_ */
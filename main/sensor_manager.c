@@ -0,0 +1,300 @@
+/*
+ * sensor_manager.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdatomic.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "sensor_manager.h"
+#include "tasks_common.h"
+
+// Tag used for ESP serial console messages
+static const char TAG[] = "sensor_manager";
+
+/**
+ * Sensor table entry
+ */
+typedef struct sensor_manager_config
+{
+	const char *name;
+	gpio_num_t gpio_num;
+} sensor_manager_config_t;
+
+// Sensors attached to the board, the index is the sensor ID
+static const sensor_manager_config_t sensor_manager_sensors[] = {
+		{ .name = "enclosure", .gpio_num = GPIO_NUM_4 },
+};
+
+#define SENSOR_MANAGER_SENSOR_COUNT		(sizeof(sensor_manager_sensors) / sizeof(sensor_manager_sensors[0]))
+
+_Static_assert(SENSOR_MANAGER_SENSOR_COUNT <= SENSOR_MANAGER_MAX_SENSORS, "Too many sensors");
+_Static_assert(SENSOR_MANAGER_READ_INTERVAL_MS >= DHT_MIN_INTERVAL_MS, "Sensors read too often");
+
+// Driver instances, NULL if the sensor could not be set up
+static dht_handle_t sensor_manager_handles[SENSOR_MANAGER_SENSOR_COUNT];
+
+// Attempts of a reader before it lets a writer it preempted finish
+#define SENSOR_MANAGER_READ_ATTEMPTS	4
+
+/**
+ * Latest reading of a sensor, guarded by a seqlock. The sensor manager task, the only writer,
+ * makes lock odd while it updates reading. Readers copy reading and retry if lock was odd or moved meanwhile,
+ * so they never block the writer and never see a torn reading.
+ */
+typedef struct sensor_manager_slot
+{
+	atomic_uint lock;
+	sensor_manager_reading_t reading;
+} sensor_manager_slot_t;
+
+// Latest readings, indexed by sensor ID, and their sequence number
+static sensor_manager_slot_t sensor_manager_slots[SENSOR_MANAGER_SENSOR_COUNT];
+static atomic_uint sensor_manager_sequence = 0;
+
+// Tasks blocked in sensor_manager_wait_for_sequence, NULL for a free entry, and the mutex guarding them.
+// A waiter checks the sequence number and registers under the mutex, so it cannot miss the wake up
+static TaskHandle_t sensor_manager_waiters[SENSOR_MANAGER_MAX_WAITERS];
+static SemaphoreHandle_t sensor_manager_waiters_mutex = NULL;
+
+// Sensor manager task handle and the timer pacing its reads
+static TaskHandle_t task_sensor_manager = NULL;
+static esp_timer_handle_t sensor_manager_timer = NULL;
+
+/**
+ * Read timer callback, lets the sensor manager task read the next sensor.
+ */
+static void sensor_manager_timer_callback(void *arg)
+{
+	xTaskNotifyGive(task_sensor_manager);
+}
+
+/**
+ * Publishes a new reading of a sensor, only called by the sensor manager task.
+ * @param slot slot of the sensor.
+ * @param reading new reading.
+ */
+static void sensor_manager_publish(sensor_manager_slot_t *slot, const sensor_manager_reading_t *reading)
+{
+	unsigned lock = atomic_load_explicit(&slot->lock, memory_order_relaxed);
+
+	atomic_store_explicit(&slot->lock, lock + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	slot->reading = *reading;
+	atomic_store_explicit(&slot->lock, lock + 2, memory_order_release);
+}
+
+/**
+ * Wakes the tasks waiting for a new sequence number, only called by the sensor manager task once it is stored.
+ */
+static void sensor_manager_wake_waiters(void)
+{
+	xSemaphoreTake(sensor_manager_waiters_mutex, portMAX_DELAY);
+	for (int i = 0; i < SENSOR_MANAGER_MAX_WAITERS; i++)
+	{
+		if (sensor_manager_waiters[i] != NULL)
+		{
+			xTaskNotifyGive(sensor_manager_waiters[i]);
+		}
+	}
+	xSemaphoreGive(sensor_manager_waiters_mutex);
+}
+
+/**
+ * Reads a sensor and stores the result.
+ * @param id sensor ID.
+ */
+static void sensor_manager_read(size_t id)
+{
+	dht_sample_t sample;
+	esp_err_t err;
+
+	if (sensor_manager_handles[id] == NULL)
+	{
+		return;
+	}
+
+	err = dht_read(sensor_manager_handles[id], &sample);
+
+	// Being the only writer, the task can read its own slot without the seqlock
+	sensor_manager_reading_t reading = sensor_manager_slots[id].reading;
+	// Every good sample is new, its timestamp moves even if the values stay the same; a failed read only if its error is new
+	bool updated = err == ESP_OK || err != reading.last_error;
+
+	reading.last_error = err;
+	if (err == ESP_OK)
+	{
+		reading.sample = sample;
+		reading.valid = true;
+	}
+
+	if (updated)
+	{
+		reading.sequence = atomic_load_explicit(&sensor_manager_sequence, memory_order_relaxed) + 1;
+	}
+	sensor_manager_publish(&sensor_manager_slots[id], &reading);
+
+	// The sequence number only moves once the new reading can be read
+	if (updated)
+	{
+		atomic_store_explicit(&sensor_manager_sequence, reading.sequence, memory_order_release);
+		sensor_manager_wake_waiters();
+	}
+
+	if (err == ESP_OK)
+	{
+		ESP_LOGI(TAG, "%s: Temperature: %.1f°C, Humidity: %.1f%%", sensor_manager_sensors[id].name, sample.temperature, sample.humidity);
+	}
+	else
+	{
+		ESP_LOGE(TAG, "%s: Read failed: %s", sensor_manager_sensors[id].name, esp_err_to_name(err));
+	}
+}
+
+/**
+ * Sensor manager task, reads one sensor per timer tick, round robin.
+ * @param pvParameters parameter which can be passed to the task.
+ */
+static void sensor_manager_task(void *pvParameters)
+{
+	size_t next = 0;
+
+	// Wait for the sensors to stabilize after power-on
+	vTaskDelay(pdMS_TO_TICKS(2000));
+
+	const esp_timer_create_args_t timer_args = {
+			.callback = &sensor_manager_timer_callback,
+			.arg = NULL,
+			.dispatch_method = ESP_TIMER_TASK,
+			.name = "sensor_manager"
+	};
+	ESP_ERROR_CHECK(esp_timer_create(&timer_args, &sensor_manager_timer));
+	ESP_ERROR_CHECK(esp_timer_start_periodic(sensor_manager_timer, (uint64_t)SENSOR_MANAGER_READ_INTERVAL_MS * 1000 / SENSOR_MANAGER_SENSOR_COUNT));
+
+	for (;;)
+	{
+		sensor_manager_read(next);
+		next = (next + 1) % SENSOR_MANAGER_SENSOR_COUNT;
+
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	}
+}
+
+void sensor_manager_start(void)
+{
+	sensor_manager_waiters_mutex = xSemaphoreCreateMutex();
+
+	for (size_t id = 0; id < SENSOR_MANAGER_SENSOR_COUNT; id++)
+	{
+		sensor_manager_reading_t *reading = &sensor_manager_slots[id].reading;
+
+		// The task reading the sensors does not run yet, so the slots need no locking
+		reading->name = sensor_manager_sensors[id].name;
+		reading->gpio_num = sensor_manager_sensors[id].gpio_num;
+		reading->last_error = dht_create(sensor_manager_sensors[id].gpio_num, &sensor_manager_handles[id]);
+		if (reading->last_error != ESP_OK)
+		{
+			ESP_LOGE(TAG, "sensor_manager_start: %s on GPIO %d not available", sensor_manager_sensors[id].name, sensor_manager_sensors[id].gpio_num);
+		}
+	}
+
+	xTaskCreatePinnedToCore(&sensor_manager_task, "sensor_manager", SENSOR_MANAGER_TASK_STACK_SIZE, NULL, SENSOR_MANAGER_TASK_PRIORITY,
+			&task_sensor_manager, SENSOR_MANAGER_TASK_CORE_ID);
+}
+
+size_t sensor_manager_get_count(void)
+{
+	return SENSOR_MANAGER_SENSOR_COUNT;
+}
+
+esp_err_t sensor_manager_get_reading(size_t id, sensor_manager_reading_t *reading)
+{
+	if (id >= SENSOR_MANAGER_SENSOR_COUNT)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	sensor_manager_slot_t *slot = &sensor_manager_slots[id];
+
+	for (int attempt = 1; ; attempt++)
+	{
+		unsigned lock = atomic_load_explicit(&slot->lock, memory_order_acquire);
+
+		if ((lock & 1) == 0)
+		{
+			*reading = slot->reading;
+			atomic_thread_fence(memory_order_acquire);
+			if (atomic_load_explicit(&slot->lock, memory_order_relaxed) == lock)
+			{
+				return ESP_OK;
+			}
+		}
+
+		// This task may have preempted the writer mid update, let it finish
+		if (attempt >= SENSOR_MANAGER_READ_ATTEMPTS)
+		{
+			vTaskDelay(1);
+		}
+	}
+}
+
+uint32_t sensor_manager_get_sequence(void)
+{
+	return atomic_load_explicit(&sensor_manager_sequence, memory_order_acquire);
+}
+
+uint32_t sensor_manager_wait_for_sequence(uint32_t after, uint32_t timeout_ms)
+{
+	TaskHandle_t self = xTaskGetCurrentTaskHandle();
+	TickType_t start = xTaskGetTickCount();
+	TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+	uint32_t sequence = sensor_manager_get_sequence();
+	int waiter = -1;
+
+	if (sequence != after || sensor_manager_waiters_mutex == NULL)
+	{
+		return sequence;
+	}
+
+	// Drop a wake up left over from an earlier wait
+	ulTaskNotifyTake(pdTRUE, 0);
+
+	xSemaphoreTake(sensor_manager_waiters_mutex, portMAX_DELAY);
+	if (sensor_manager_get_sequence() == after)
+	{
+		for (int i = 0; i < SENSOR_MANAGER_MAX_WAITERS && waiter < 0; i++)
+		{
+			if (sensor_manager_waiters[i] == NULL)
+			{
+				sensor_manager_waiters[i] = self;
+				waiter = i;
+			}
+		}
+	}
+	xSemaphoreGive(sensor_manager_waiters_mutex);
+
+	if (waiter >= 0)
+	{
+		while (sensor_manager_get_sequence() == after)
+		{
+			TickType_t elapsed = xTaskGetTickCount() - start;
+
+			if (elapsed >= timeout || ulTaskNotifyTake(pdTRUE, timeout - elapsed) == 0)
+			{
+				break;
+			}
+		}
+
+		xSemaphoreTake(sensor_manager_waiters_mutex, portMAX_DELAY);
+		sensor_manager_waiters[waiter] = NULL;
+		xSemaphoreGive(sensor_manager_waiters_mutex);
+	}
+
+	return sensor_manager_get_sequence();
+}
@@ -0,0 +1,70 @@
+/*
+ * sensor_manager.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef MAIN_SENSOR_MANAGER_H_
+#define MAIN_SENSOR_MANAGER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dht.h"
+
+// Sensor manager settings
+#define SENSOR_MANAGER_MAX_SENSORS			4			// One RMT receive channel per sensor
+#define SENSOR_MANAGER_READ_INTERVAL_MS		3000		// Time between two reads of the same sensor
+#define SENSOR_MANAGER_MAX_WAITERS			4			// Tasks which can wait for a new reading at the same time
+
+/**
+ * Latest reading of a sensor, always a consistent snapshot
+ */
+typedef struct sensor_manager_reading
+{
+	const char *name;
+	gpio_num_t gpio_num;
+	bool valid;							///> sample holds a reading
+	dht_sample_t sample;				///> Latest good reading, with the time it was taken
+	esp_err_t last_error;				///> Result of the latest read
+	uint32_t sequence;					///> Sequence number the snapshot was published with
+} sensor_manager_reading_t;
+
+/**
+ * Creates the sensors of the sensor table and the task reading them.
+ * The reads are spread evenly over SENSOR_MANAGER_READ_INTERVAL_MS, so the sensors are read one at a time.
+ */
+void sensor_manager_start(void);
+
+/**
+ * Gets the number of sensors in the sensor table, their IDs are 0 to count - 1.
+ * @return number of sensors.
+ */
+size_t sensor_manager_get_count(void);
+
+/**
+ * Gets the latest reading of a sensor. Never blocks the sensor manager task.
+ * @param id sensor ID.
+ * @param reading set to the reading.
+ * @return ESP_OK, otherwise ESP_ERR_INVALID_ARG if there is no sensor with that ID.
+ */
+esp_err_t sensor_manager_get_reading(size_t id, sensor_manager_reading_t *reading);
+
+/**
+ * Gets the sequence number of the readings.
+ * @return counter incremented with every good sample of any sensor and with every change of a sensor's error.
+ */
+uint32_t sensor_manager_get_sequence(void);
+
+/**
+ * Waits for a reading newer than the given sequence number. The caller blocks, it does not poll:
+ * the sensor manager task wakes it when it publishes a new sequence number.
+ * At most SENSOR_MANAGER_MAX_WAITERS tasks can wait at the same time, further callers return right away.
+ * @param after sequence number the caller has seen.
+ * @param timeout_ms longest time to wait.
+ * @return current sequence number, equal to after if there was no new reading in time.
+ */
+uint32_t sensor_manager_wait_for_sequence(uint32_t after, uint32_t timeout_ms);
+
+#endif /* MAIN_SENSOR_MANAGER_H_ */
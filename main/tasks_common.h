@@ -23,9 +23,24 @@
 #define HTTP_SERVER_MONITOR_PRIORITY		3
 #define HTTP_SERVER_MONITOR_CORE_ID			0
 
-// DHT22 Sensor task
-#define DHT22_TASK_STACK_SIZE				4096
-#define DHT22_TASK_PRIORITY					5
-#define DHT22_TASK_CORE_ID					1
+// HTTP Server async worker tasks, one per core starting at core 0
+#define HTTP_SERVER_ASYNC_WORKER_COUNT		2
+#define HTTP_SERVER_ASYNC_WORKER_STACK_SIZE	6144
+#define HTTP_SERVER_ASYNC_WORKER_PRIORITY	4
+
+// OTA writer task
+#define OTA_WRITER_TASK_STACK_SIZE			4096
+#define OTA_WRITER_TASK_PRIORITY			4
+#define OTA_WRITER_TASK_CORE_ID				1
+
+// OTA pre-erase task
+#define OTA_PRE_ERASE_TASK_STACK_SIZE		3072
+#define OTA_PRE_ERASE_TASK_PRIORITY			1
+#define OTA_PRE_ERASE_TASK_CORE_ID			1
+
+// Sensor manager task, reads every DHT sensor
+#define SENSOR_MANAGER_TASK_STACK_SIZE		4096
+#define SENSOR_MANAGER_TASK_PRIORITY		5
+#define SENSOR_MANAGER_TASK_CORE_ID			1
 
 #endif /* MAIN_TASKS_COMMON_H_ */
@@ -3,13 +3,16 @@
  */
 var seconds 	= null;
 var otaTimerVar =  null;
+var otaSocket	= null;
+var dhtSensorSeq = null;
 
 /**
  * Initialize functions here.
  */
 $(document).ready(function(){
 	getUpdateStatus();
-	startDHTSensorInterval();
+	startOTAProgress();
+	getDHTSensorValues();
 });   
 
 /**
@@ -41,9 +44,39 @@ function updateFirmware()
         // Http Request
         var request = new XMLHttpRequest();
 
-        request.upload.addEventListener("progress", updateProgress);
-        request.open('POST', "/OTAupdate");
+        // Images compressed with heatshrink (.hs) are decompressed by the ESP32 while flashing,
+        // patches (.patch) are applied against the running firmware
+        var fileName = file.name;
+        var query = [];
+        if (fileName.endsWith(".hs"))
+        {
+            query.push("encoding=heatshrink");
+            fileName = fileName.slice(0, -3);
+        }
+        if (fileName.endsWith(".patch"))
+        {
+            query.push("delta=1");
+        }
+        // The ESP32 refuses the version it is running unless told to flash it anyway
+        if (document.getElementById("force_update").checked)
+        {
+            query.push("force=1");
+        }
+        var requestURL = "/OTAupdate";
+        if (query.length > 0)
+        {
+            requestURL += "?" + query.join("&");
+        }
+
+        request.open('POST', requestURL);
         request.responseType = "blob";
+        // Progress is only pushed for the upload which got the update session, a rejected one is told here
+        request.onload = function() {
+            if (request.status == 409)
+            {
+                document.getElementById("ota_update_status").innerHTML = "Another Firmware Update is in Progress, try again later";
+            }
+        };
         request.send(formData);
     } 
 	else 
@@ -53,17 +86,54 @@ function updateFirmware()
 }
 
 /**
- * Progress on transfers from the server to the client (downloads).
+ * Listens for the firmware update progress pushed by the ESP32, so the page does not poll while the upload is running.
  */
-function updateProgress(oEvent) 
+function startOTAProgress()
 {
-    if (oEvent.lengthComputable) 
+    otaSocket = new WebSocket("ws://" + window.location.host + "/ota/ws");
+
+    otaSocket.onmessage = function(event) {
+        updateProgress(JSON.parse(event.data));
+    };
+
+    // Reconnect e.g. after the connection was lost
+    otaSocket.onclose = function() {
+        setTimeout(startOTAProgress, 2000);
+    };
+}
+
+/**
+ * Displays the firmware update progress received from the ESP32.
+ */
+function updateProgress(progress)
+{
+    if (progress.phase == "receiving")
 	{
-        getUpdateStatus();
-    } 
-	else 
+        var percent = (progress.total > 0) ? Math.floor(progress.received * 100 / progress.total) : 0;
+        document.getElementById("ota_update_status").innerHTML = "Firmware Update in Progress... " + progress.received + " of " + progress.total + " bytes (" + percent + "%)";
+    }
+    else if (progress.phase == "verifying")
 	{
-        window.alert('total size is unknown')
+        document.getElementById("ota_update_status").innerHTML = "Verifying Firmware...";
+    }
+    else if (progress.phase == "done")
+	{
+		// If flashing was complete it will return a 1, else -1
+        if (progress.ota_update_status == 1)
+		{
+    		// Set the countdown timer time
+            seconds = 10;
+            // Start the countdown timer
+            otaRebootTimer();
+        }
+        else if (progress.error == "ESP_ERR_INVALID_VERSION")
+		{
+            document.getElementById("ota_update_status").innerHTML = "This firmware version is already running, tick Force Update to flash it anyway";
+        }
+        else
+		{
+            document.getElementById("ota_update_status").innerHTML = "!!! Upload Error !!!";
+        }
     }
 }
 
@@ -119,13 +189,21 @@ function otaRebootTimer()
 
 /**
  * Gets DHT22 sensor temperature and humidity values for display on the web page.
+ * After the first reading the server holds the request until there is a newer one (long-poll).
  */
 function getDHTSensorValues()
 {
-    $.getJSON('/dhtSensor.json', function(data) {
+    var url = (dhtSensorSeq === null) ? '/dhtSensor.json' : '/dhtSensor.json?after=' + dhtSensorSeq;
+
+    $.getJSON(url, function(data) {
         console.log("Received data:", data); // Debug log
         $("#temperature_reading").text(data["temp"]);
         $("#humidity_reading").text(data["humidity"]);
+
+        // The same reading again means the server could not hold the request or it timed out, so wait a bit
+        var delay = (data["seq"] === dhtSensorSeq) ? 3000 : 0;
+        dhtSensorSeq = data["seq"];
+        setTimeout(getDHTSensorValues, delay);
     })
     .fail(function(jqXHR, textStatus, errorThrown) {
         console.error("AJAX Error:", textStatus, errorThrown);
@@ -135,15 +213,9 @@ function getDHTSensorValues()
         // Display error on page
         $("#temperature_reading").text("Error");
         $("#humidity_reading").text("Error");
-    });
-}
 
-/**
- * Sets the interval for getting the updated DHT22 sensor values.
- */
-function startDHTSensorInterval()
-{
-	setInterval(getDHTSensorValues, 5000);
+        setTimeout(getDHTSensorValues, 5000);
+    });
 }
 
 
@@ -0,0 +1,33 @@
+/*
+ * webpage_assets.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef MAIN_WEBPAGE_ASSETS_H_
+#define MAIN_WEBPAGE_ASSETS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Web page asset embedded into the firmware, the table of them is generated by webpage_assets.py
+ */
+typedef struct webpage_asset
+{
+	const char *path;					///> URI the asset is served at
+	const char *type;					///> MIME type
+	const uint8_t *data;				///> Asset, gzip compressed
+	size_t len;							///> Size of data
+	const char *etag;					///> Strong ETag, taken from the hash of data
+	const uint8_t *identity_data;		///> Asset, uncompressed, for clients which do not accept gzip
+	size_t identity_len;				///> Size of identity_data
+	const char *identity_etag;			///> Strong ETag, taken from the hash of identity_data
+	const char *cache_control;			///> Cache-Control policy
+} webpage_asset_t;
+
+// Assets sorted by path, so they can be looked up with a binary search
+extern const webpage_asset_t webpage_assets[];
+extern const size_t webpage_asset_count;
+
+#endif /* MAIN_WEBPAGE_ASSETS_H_ */
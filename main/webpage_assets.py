@@ -0,0 +1,128 @@
+#!/usr/bin/env python
+#
+# webpage_assets.py
+#
+#  Created on: Oct 16, 2026
+#
+# Build step for the web page assets embedded into the firmware.
+# Every asset is gzip compressed, so it is sent as is with "Content-Encoding: gzip" to the clients which accept it.
+# The uncompressed asset is embedded as well, for the few clients which do not.
+# webpage_assets_table.c gets the table the HTTP server looks the assets up in, see webpage_assets.h.
+#
+# usage: webpage_assets.py <output dir> <asset>...
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+# MIME types by file extension
+MIME_TYPES = {
+    '.css': 'text/css',
+    '.html': 'text/html',
+    '.ico': 'image/x-icon',
+    '.js': 'application/javascript',
+}
+
+# Assets served at another path than their file name
+PATHS = {
+    'index.html': '/',
+}
+
+# The page itself is revalidated on every load, so a firmware update shows up right away,
+# assets which never change under their name are kept for a year
+CACHE_REVALIDATE = 'no-cache'
+CACHE_LONG_LIVED = 'public, max-age=31536000, immutable'
+LONG_LIVED_ASSETS = ('favicon.ico', 'jquery-3.3.1.min.js')
+
+
+def symbol_name(name):
+    # Symbol target_add_binary_data creates for the file name
+    return '_binary_' + re.sub(r'[^A-Za-z0-9]', '_', name) + '_start'
+
+
+def compress(asset, output_dir):
+    with open(asset, 'rb') as f:
+        data = f.read()
+
+    # No file name and a fixed time stamp keep the output identical from build to build
+    output = os.path.join(output_dir, os.path.basename(asset) + '.gz')
+    with open(output, 'wb') as f:
+        with gzip.GzipFile(filename='', mode='wb', fileobj=f, compresslevel=9, mtime=0) as gz:
+            gz.write(data)
+
+    print('%s: %d -> %d bytes' % (os.path.basename(asset), len(data), os.path.getsize(output)))
+
+    with open(output, 'rb') as f:
+        compressed = f.read()
+
+    name = os.path.basename(asset)
+    return {
+        'name': name,
+        'path': PATHS.get(name, '/' + name),
+        'type': MIME_TYPES[os.path.splitext(name)[1]],
+        'len': len(compressed),
+        'etag': hashlib.sha256(compressed).hexdigest()[:16],
+        'identity_len': len(data),
+        'identity_etag': hashlib.sha256(data).hexdigest()[:16],
+        'cache_control': CACHE_LONG_LIVED if name in LONG_LIVED_ASSETS else CACHE_REVALIDATE,
+    }
+
+
+def write_table(assets, output_dir):
+    # Sorted by path as strcmp orders them, for the binary search in the HTTP server
+    assets = sorted(assets, key=lambda asset: asset['path'].encode())
+
+    lines = [
+        '/*',
+        ' * webpage_assets_table.c',
+        ' *',
+        ' * Generated by webpage_assets.py, do not edit.',
+        ' */',
+        '',
+        '#include "webpage_assets.h"',
+        '',
+    ]
+    for asset in assets:
+        for name in (asset['name'] + '.gz', asset['name']):
+            lines.append('extern const uint8_t %s[] asm("%s");' % (symbol_name(name), symbol_name(name)))
+    lines += ['', 'const webpage_asset_t webpage_assets[] = {']
+    for asset in assets:
+        lines += [
+            '\t{',
+            '\t\t.path = "%s",' % asset['path'],
+            '\t\t.type = "%s",' % asset['type'],
+            '\t\t.data = %s,' % symbol_name(asset['name'] + '.gz'),
+            '\t\t.len = %d,' % asset['len'],
+            '\t\t.etag = "\\"%s\\"",' % asset['etag'],
+            '\t\t.identity_data = %s,' % symbol_name(asset['name']),
+            '\t\t.identity_len = %d,' % asset['identity_len'],
+            '\t\t.identity_etag = "\\"%s\\"",' % asset['identity_etag'],
+            '\t\t.cache_control = "%s",' % asset['cache_control'],
+            '\t},',
+        ]
+    lines += [
+        '};',
+        '',
+        'const size_t webpage_asset_count = sizeof(webpage_assets) / sizeof(webpage_assets[0]);',
+        '',
+    ]
+
+    with open(os.path.join(output_dir, 'webpage_assets_table.c'), 'w') as f:
+        f.write('\n'.join(lines))
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit('usage: %s <output dir> <asset>...' % sys.argv[0])
+
+    output_dir = sys.argv[1]
+    os.makedirs(output_dir, exist_ok=True)
+
+    assets = [compress(asset, output_dir) for asset in sys.argv[2:]]
+    write_table(assets, output_dir)
+
+
+if __name__ == '__main__':
+    main()
@@ -9,7 +9,7 @@
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "driver/gpio.h"
-#include "dht11.h"
+#include "dht.h"
 
 #define DHT11_GPIO GPIO_NUM_4  // GPIO 4 is safe on ESP32-S3
 #define READ_INTERVAL_MS 3000  // Read every 3 seconds (DHT11 minimum is 2 seconds)
@@ -61,7 +61,13 @@ void app_main(void)
         ESP_LOGI(TAG, "✓ GPIO level is HIGH - wiring looks OK");
     }
 
-    dht11_reading_t reading;
+    dht_handle_t dht;
+    dht_sample_t reading;
+
+    if (dht_create(DHT11_GPIO, &dht) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up the DHT11 driver");
+        return;
+    }
 
     // Wait for sensor to stabilize
     ESP_LOGI(TAG, "Waiting 2 seconds for sensor to stabilize...");
@@ -73,7 +79,7 @@ void app_main(void)
     while (1) {
         ESP_LOGI(TAG, "=== Reading DHT11 (Success: %d, Fail: %d) ===", success_count, fail_count);
         
-        esp_err_t result = dht11_read(DHT11_GPIO, &reading);
+        esp_err_t result = dht_read(dht, &reading);
         
         if (result == ESP_OK) {
             success_count++;
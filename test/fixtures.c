@@ -0,0 +1,359 @@
+/*
+ * fixtures.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "fixtures.h"
+#include "heatshrink_decoder.h"
+
+// Heatshrink encoder settings
+#define FIXTURE_HS_MAX_COUNT		(1 << HEATSHRINK_LOOKAHEAD_BITS)
+#define FIXTURE_HS_MIN_MATCH		3			// Shorter matches cost more bits than literals
+#define FIXTURE_HS_HASH_BITS		12
+#define FIXTURE_HS_CHAIN_LIMIT		32
+
+/**
+ * Next value of a linear congruential generator.
+ */
+static uint32_t fixture_random(uint32_t *state)
+{
+	*state = *state * 1664525u + 1013904223u;
+
+	return *state >> 8;
+}
+
+void fixture_firmware(uint8_t *buf, size_t len, uint32_t seed)
+{
+	static const uint32_t opcodes[] = {
+			0x004136, 0x0020c0, 0x00a092, 0x0c0c1d, 0x81a2a0, 0x0008e0, 0x22a0f0, 0x1df01d,
+	};
+	static const char *const strings[] = {
+			"ota_writer_begin: Writing to partition subtype %d at offset 0x%x\n",
+			"http_server_OTA_update_handler: Receiving firmware\n",
+			"sensor_manager: Temperature: %.1f, Humidity: %.1f\n",
+			"Guru Meditation Error: Core  0 panic'ed\n",
+	};
+	uint32_t state = seed;
+	size_t pos = 0;
+
+	while (pos < len)
+	{
+		size_t block = (len - pos < 256) ? len - pos : 256;
+		uint32_t kind = fixture_random(&state) % 10;
+
+		for (size_t i = 0; i < block; i++)
+		{
+			if (kind < 5)
+			{
+				// Code: a few common instructions with varying operands
+				uint32_t word = opcodes[fixture_random(&state) % 8] ^ ((fixture_random(&state) % 4) << 12);
+				buf[pos + i] = word >> (8 * (i % 3));
+			}
+			else if (kind < 7)
+			{
+				const char *s = strings[(pos / 256) % 4];
+				buf[pos + i] = s[i % strlen(s)];
+			}
+			else if (kind < 9)
+			{
+				buf[pos + i] = fixture_random(&state);
+			}
+			else
+			{
+				buf[pos + i] = 0xFF;
+			}
+		}
+		pos += block;
+	}
+}
+
+size_t fixture_multipart(const uint8_t *file, size_t len, uint8_t *out, size_t cap)
+{
+	char head[256];
+	static const char tail[] = "\r\n--" FIXTURE_BOUNDARY "--\r\n";
+
+	int head_len = snprintf(head, sizeof(head),
+			"--" FIXTURE_BOUNDARY "\r\n"
+			"Content-Disposition: form-data; name=\"file\"; filename=\"firmware.bin\"\r\n"
+			"Content-Type: application/octet-stream\r\n\r\n");
+
+	if ((size_t)head_len + len + sizeof(tail) - 1 > cap)
+	{
+		return 0;
+	}
+
+	memcpy(out, head, head_len);
+	memcpy(&out[head_len], file, len);
+	memcpy(&out[head_len + len], tail, sizeof(tail) - 1);
+
+	return head_len + len + sizeof(tail) - 1;
+}
+
+/**
+ * MSB first bit writer of the heatshrink encoder
+ */
+typedef struct fixture_bits
+{
+	uint8_t *out;
+	size_t cap;
+	size_t len;
+	uint8_t bit;							///> Bits used in the last byte, 0 if it is complete
+	int overflow;
+} fixture_bits_t;
+
+/**
+ * Appends a bit field to the stream.
+ */
+static void fixture_bits_put(fixture_bits_t *bits, uint32_t value, int count)
+{
+	while (count-- > 0)
+	{
+		if (bits->bit == 0)
+		{
+			if (bits->len == bits->cap)
+			{
+				bits->overflow = 1;
+				return;
+			}
+			bits->out[bits->len++] = 0;
+		}
+		if ((value >> count) & 1)
+		{
+			bits->out[bits->len - 1] |= 0x80 >> bits->bit;
+		}
+		bits->bit = (bits->bit + 1) % 8;
+	}
+}
+
+/**
+ * Hash of the 3 bytes starting at p.
+ */
+static uint32_t fixture_hs_hash(const uint8_t *p)
+{
+	return ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761u) >> (32 - FIXTURE_HS_HASH_BITS);
+}
+
+size_t fixture_heatshrink_encode(const uint8_t *in, size_t len, uint8_t *out, size_t cap)
+{
+	static int32_t head[1 << FIXTURE_HS_HASH_BITS];
+	static int32_t prev[HEATSHRINK_WINDOW_SIZE];
+	fixture_bits_t bits = { .out = out, .cap = cap };
+	size_t pos = 0;
+
+	memset(head, 0xFF, sizeof(head));
+
+	while (pos < len)
+	{
+		size_t best_len = 0;
+		size_t best_dist = 0;
+
+		if (pos + FIXTURE_HS_MIN_MATCH <= len)
+		{
+			int32_t candidate = head[fixture_hs_hash(&in[pos])];
+
+			for (int n = 0; n < FIXTURE_HS_CHAIN_LIMIT && candidate >= 0 && pos - candidate <= HEATSHRINK_WINDOW_SIZE; n++)
+			{
+				size_t match = 0;
+				while (match < FIXTURE_HS_MAX_COUNT && pos + match < len && in[candidate + match] == in[pos + match])
+				{
+					match++;
+				}
+				if (match > best_len)
+				{
+					best_len = match;
+					best_dist = pos - candidate;
+				}
+				candidate = prev[candidate % HEATSHRINK_WINDOW_SIZE];
+			}
+		}
+
+		size_t step = 1;
+		if (best_len >= FIXTURE_HS_MIN_MATCH)
+		{
+			fixture_bits_put(&bits, 0, 1);
+			fixture_bits_put(&bits, best_dist - 1, HEATSHRINK_WINDOW_BITS);
+			fixture_bits_put(&bits, best_len - 1, HEATSHRINK_LOOKAHEAD_BITS);
+			step = best_len;
+		}
+		else
+		{
+			fixture_bits_put(&bits, 1, 1);
+			fixture_bits_put(&bits, in[pos], 8);
+		}
+
+		// Index every position passed over
+		for (size_t end = pos + step; pos < end; pos++)
+		{
+			if (pos + FIXTURE_HS_MIN_MATCH <= len)
+			{
+				uint32_t hash = fixture_hs_hash(&in[pos]);
+				prev[pos % HEATSHRINK_WINDOW_SIZE] = head[hash];
+				head[hash] = pos;
+			}
+		}
+	}
+
+	return bits.overflow ? 0 : bits.len;
+}
+
+void fixture_bspatch_offtout(int64_t value, uint8_t *buf)
+{
+	uint64_t y = (value < 0) ? -value : value;
+
+	for (int i = 0; i < 8; i++)
+	{
+		buf[i] = y >> (8 * i);
+	}
+	if (value < 0)
+	{
+		buf[7] |= 0x80;
+	}
+}
+
+size_t fixture_bspatch_create(const uint8_t *old_image, size_t old_len, const uint8_t *new_image, size_t insert_at, size_t insert_len,
+		uint8_t *out, size_t cap)
+{
+	size_t tail_len = old_len - insert_at;
+	size_t len = 16 + 8 + 24 + insert_at + insert_len + ((tail_len > 0) ? 24 + tail_len : 0);
+	uint8_t *p = out;
+
+	if (len > cap || insert_at > old_len)
+	{
+		return 0;
+	}
+
+	memcpy(p, "ENDSLEY/BSDIFF43", 16);
+	fixture_bspatch_offtout(old_len + insert_len, &p[16]);
+	p += 24;
+
+	// Unchanged head, diffed against the old image, then the inserted bytes
+	fixture_bspatch_offtout(insert_at, &p[0]);
+	fixture_bspatch_offtout(insert_len, &p[8]);
+	fixture_bspatch_offtout(0, &p[16]);
+	p += 24;
+	for (size_t i = 0; i < insert_at; i++)
+	{
+		*p++ = new_image[i] - old_image[i];
+	}
+	memcpy(p, &new_image[insert_at], insert_len);
+	p += insert_len;
+
+	// The rest of the old image, shifted by the insertion
+	if (tail_len > 0)
+	{
+		fixture_bspatch_offtout(tail_len, &p[0]);
+		fixture_bspatch_offtout(0, &p[8]);
+		fixture_bspatch_offtout(0, &p[16]);
+		p += 24;
+		for (size_t i = 0; i < tail_len; i++)
+		{
+			*p++ = new_image[insert_at + insert_len + i] - old_image[insert_at + i];
+		}
+	}
+
+	return p - out;
+}
+
+// SHA-256 round constants (FIPS 180-4)
+static const uint32_t fixture_sha256_k[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define FIXTURE_ROTR(x, n)		(((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * Hashes the 64 byte block of the context.
+ */
+static void fixture_sha256_block(fixture_sha256_t *sha)
+{
+	uint32_t w[64];
+	uint32_t v[8];
+
+	for (int i = 0; i < 16; i++)
+	{
+		w[i] = (uint32_t)sha->block[4 * i] << 24 | sha->block[4 * i + 1] << 16 | sha->block[4 * i + 2] << 8 | sha->block[4 * i + 3];
+	}
+	for (int i = 16; i < 64; i++)
+	{
+		uint32_t s0 = FIXTURE_ROTR(w[i - 15], 7) ^ FIXTURE_ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = FIXTURE_ROTR(w[i - 2], 17) ^ FIXTURE_ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	memcpy(v, sha->state, sizeof(v));
+	for (int i = 0; i < 64; i++)
+	{
+		uint32_t s1 = FIXTURE_ROTR(v[4], 6) ^ FIXTURE_ROTR(v[4], 11) ^ FIXTURE_ROTR(v[4], 25);
+		uint32_t ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+		uint32_t t1 = v[7] + s1 + ch + fixture_sha256_k[i] + w[i];
+		uint32_t s0 = FIXTURE_ROTR(v[0], 2) ^ FIXTURE_ROTR(v[0], 13) ^ FIXTURE_ROTR(v[0], 22);
+		uint32_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+
+		memmove(&v[1], &v[0], 7 * sizeof(v[0]));
+		v[4] += t1;
+		v[0] = t1 + s0 + maj;
+	}
+	for (int i = 0; i < 8; i++)
+	{
+		sha->state[i] += v[i];
+	}
+}
+
+void fixture_sha256_init(fixture_sha256_t *sha)
+{
+	static const uint32_t initial[8] = {
+			0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+	};
+
+	memcpy(sha->state, initial, sizeof(initial));
+	sha->len = 0;
+}
+
+void fixture_sha256_update(fixture_sha256_t *sha, const uint8_t *data, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+	{
+		sha->block[sha->len++ % 64] = data[i];
+		if (sha->len % 64 == 0)
+		{
+			fixture_sha256_block(sha);
+		}
+	}
+}
+
+void fixture_sha256_finish(fixture_sha256_t *sha, uint8_t *digest)
+{
+	uint64_t bits = sha->len * 8;
+	uint8_t pad = 0x80;
+
+	fixture_sha256_update(sha, &pad, 1);
+	pad = 0;
+	while (sha->len % 64 != 56)
+	{
+		fixture_sha256_update(sha, &pad, 1);
+	}
+	for (int i = 7; i >= 0; i--)
+	{
+		pad = bits >> (8 * i);
+		fixture_sha256_update(sha, &pad, 1);
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		digest[4 * i] = sha->state[i] >> 24;
+		digest[4 * i + 1] = sha->state[i] >> 16;
+		digest[4 * i + 2] = sha->state[i] >> 8;
+		digest[4 * i + 3] = sha->state[i];
+	}
+}
@@ -0,0 +1,96 @@
+/*
+ * fixtures.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Test data for the host tests and the benchmark: firmware-like images and the
+ * multipart, heatshrink and bsdiff streams the device receives them in.
+ */
+
+#ifndef TEST_FIXTURES_H_
+#define TEST_FIXTURES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Boundary Chrome uses for FormData uploads
+#define FIXTURE_BOUNDARY		"----WebKitFormBoundary7MA4YWxkTrZu0gW"
+
+/**
+ * Fills a buffer with a firmware-like image: instruction-like words, strings, random data and erased padding.
+ * The same seed always gives the same image.
+ * @param buf destination buffer.
+ * @param len number of bytes to fill.
+ * @param seed seed of the pseudo random generator.
+ */
+void fixture_firmware(uint8_t *buf, size_t len, uint32_t seed);
+
+/**
+ * Wraps a file into a multipart/form-data body the way a browser uploads it.
+ * @param file file contents.
+ * @param len size of file.
+ * @param out destination buffer.
+ * @param cap size of out.
+ * @return size of the body, 0 if it does not fit.
+ */
+size_t fixture_multipart(const uint8_t *file, size_t len, uint8_t *out, size_t cap);
+
+/**
+ * Compresses data into a heatshrink stream matching HEATSHRINK_WINDOW_BITS and HEATSHRINK_LOOKAHEAD_BITS.
+ * @param in data to compress.
+ * @param len size of in.
+ * @param out destination buffer.
+ * @param cap size of out.
+ * @return size of the stream, 0 if it does not fit.
+ */
+size_t fixture_heatshrink_encode(const uint8_t *in, size_t len, uint8_t *out, size_t cap);
+
+/**
+ * Creates a bsdiff patch for a release which inserts bytes into the old image and changes some others:
+ * new_image is old_image with insert_len bytes inserted at insert_at, plus any byte changes.
+ * @param old_image old image.
+ * @param old_len size of old_image.
+ * @param new_image new image, old_len + insert_len bytes.
+ * @param insert_at offset in the old image the bytes are inserted at.
+ * @param insert_len number of inserted bytes.
+ * @param out destination buffer.
+ * @param cap size of out.
+ * @return size of the patch, 0 if it does not fit.
+ */
+size_t fixture_bspatch_create(const uint8_t *old_image, size_t old_len, const uint8_t *new_image, size_t insert_at, size_t insert_len,
+		uint8_t *out, size_t cap);
+
+/**
+ * Encodes an 8 byte sign-magnitude integer of a bsdiff patch.
+ * @param value integer to encode.
+ * @param buf set to the 8 bytes.
+ */
+void fixture_bspatch_offtout(int64_t value, uint8_t *buf);
+
+/**
+ * SHA-256 context of the host reference implementation, standing in for mbedtls on the device
+ */
+typedef struct fixture_sha256
+{
+	uint32_t state[8];
+	uint64_t len;
+	uint8_t block[64];
+} fixture_sha256_t;
+
+/**
+ * Starts a SHA-256 computation.
+ */
+void fixture_sha256_init(fixture_sha256_t *sha);
+
+/**
+ * Hashes the next chunk of data.
+ */
+void fixture_sha256_update(fixture_sha256_t *sha, const uint8_t *data, size_t len);
+
+/**
+ * Ends a SHA-256 computation.
+ * @param digest set to the 32 byte digest.
+ */
+void fixture_sha256_finish(fixture_sha256_t *sha, uint8_t *digest);
+
+#endif /* TEST_FIXTURES_H_ */
@@ -0,0 +1,19 @@
+/*
+ * gpio.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the ESP-IDF header of the same name, only the types the firmware headers need.
+ */
+
+#ifndef TEST_IDF_SHIM_DRIVER_GPIO_H_
+#define TEST_IDF_SHIM_DRIVER_GPIO_H_
+
+typedef enum
+{
+	GPIO_NUM_NC = -1,
+	GPIO_NUM_0 = 0,
+	GPIO_NUM_MAX = 49,
+} gpio_num_t;
+
+#endif /* TEST_IDF_SHIM_DRIVER_GPIO_H_ */
@@ -0,0 +1,58 @@
+/*
+ * esp_app_format.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the ESP-IDF header of the same name.
+ */
+
+#ifndef TEST_IDF_SHIM_ESP_APP_FORMAT_H_
+#define TEST_IDF_SHIM_ESP_APP_FORMAT_H_
+
+#include <stdint.h>
+
+#include "esp_app_desc.h"
+
+#define ESP_IMAGE_HEADER_MAGIC		0xE9
+#define ESP_IMAGE_MAX_SEGMENTS		16
+
+typedef enum
+{
+	ESP_CHIP_ID_ESP32 = 0x0000,
+	ESP_CHIP_ID_ESP32S2 = 0x0002,
+	ESP_CHIP_ID_ESP32C3 = 0x0005,
+	ESP_CHIP_ID_ESP32S3 = 0x0009,
+	ESP_CHIP_ID_INVALID = 0xFFFF,
+} __attribute__((packed)) esp_chip_id_t;
+
+/**
+ * Header at the start of an application image
+ */
+typedef struct
+{
+	uint8_t magic;
+	uint8_t segment_count;
+	uint8_t spi_mode;
+	uint8_t spi_speed: 4;
+	uint8_t spi_size: 4;
+	uint32_t entry_addr;
+	uint8_t wp_pin;
+	uint8_t spi_pin_drv[3];
+	esp_chip_id_t chip_id;
+	uint8_t min_chip_rev;
+	uint16_t min_chip_rev_full;
+	uint16_t max_chip_rev_full;
+	uint8_t reserved[4];
+	uint8_t hash_appended;
+} __attribute__((packed)) esp_image_header_t;
+
+/**
+ * Header in front of every segment of an image
+ */
+typedef struct
+{
+	uint32_t load_addr;
+	uint32_t data_len;
+} esp_image_segment_header_t;
+
+#endif /* TEST_IDF_SHIM_ESP_APP_FORMAT_H_ */
@@ -0,0 +1,51 @@
+/*
+ * esp_image_format.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the ESP-IDF header of the same name. Images are checked by walking their segment headers,
+ * the checksum byte and the appended hash are not checked.
+ */
+
+#ifndef TEST_IDF_SHIM_ESP_IMAGE_FORMAT_H_
+#define TEST_IDF_SHIM_ESP_IMAGE_FORMAT_H_
+
+#include <stdint.h>
+
+#include "esp_app_format.h"
+#include "esp_err.h"
+
+#define ESP_ERR_IMAGE_BASE			0x2000
+#define ESP_ERR_IMAGE_FLASH_FAIL	(ESP_ERR_IMAGE_BASE + 1)
+#define ESP_ERR_IMAGE_INVALID		(ESP_ERR_IMAGE_BASE + 2)
+
+typedef struct
+{
+	uint32_t offset;
+	uint32_t size;
+} esp_partition_pos_t;
+
+typedef struct
+{
+	uint32_t start_addr;
+	esp_image_header_t image;
+	esp_image_segment_header_t segments[ESP_IMAGE_MAX_SEGMENTS];
+	uint32_t segment_data[ESP_IMAGE_MAX_SEGMENTS];
+	uint32_t image_len;
+	uint8_t image_digest[32];
+} esp_image_metadata_t;
+
+typedef enum
+{
+	ESP_IMAGE_VERIFY,
+	ESP_IMAGE_VERIFY_SILENT,
+} esp_image_load_mode_t;
+
+esp_err_t esp_image_get_metadata(const esp_partition_pos_t *part, esp_image_metadata_t *metadata);
+
+/**
+ * Validates the image of a partition, reading all of it from flash and hashing it as the device does.
+ */
+esp_err_t esp_image_verify(esp_image_load_mode_t mode, const esp_partition_pos_t *part, esp_image_metadata_t *data);
+
+#endif /* TEST_IDF_SHIM_ESP_IMAGE_FORMAT_H_ */
@@ -0,0 +1,40 @@
+/*
+ * esp_log.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the ESP-IDF header of the same name. Messages go to stderr,
+ * only errors and warnings unless idf_shim_set_log_level asks for more.
+ */
+
+#ifndef TEST_IDF_SHIM_ESP_LOG_H_
+#define TEST_IDF_SHIM_ESP_LOG_H_
+
+#include "esp_err.h"
+
+typedef enum
+{
+	ESP_LOG_NONE,
+	ESP_LOG_ERROR,
+	ESP_LOG_WARN,
+	ESP_LOG_INFO,
+	ESP_LOG_DEBUG,
+	ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+/**
+ * Prints a log message of the firmware.
+ * The format is not checked by the compiler: the firmware formats e.g. uint32_t with %lu, which is right on the device only.
+ * @param level level of the message.
+ * @param tag tag of the module.
+ * @param format printf style format.
+ */
+void idf_shim_log(esp_log_level_t level, const char *tag, const char *format, ...);
+
+#define ESP_LOGE(tag, format, ...)	idf_shim_log(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)	idf_shim_log(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)	idf_shim_log(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)	idf_shim_log(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...)	idf_shim_log(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+#endif /* TEST_IDF_SHIM_ESP_LOG_H_ */
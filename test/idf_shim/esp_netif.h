@@ -0,0 +1,16 @@
+/*
+ * esp_netif.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the ESP-IDF header of the same name, only the types the firmware headers need.
+ */
+
+#ifndef TEST_IDF_SHIM_ESP_NETIF_H_
+#define TEST_IDF_SHIM_ESP_NETIF_H_
+
+#include "esp_err.h"
+
+typedef struct esp_netif_obj esp_netif_t;
+
+#endif /* TEST_IDF_SHIM_ESP_NETIF_H_ */
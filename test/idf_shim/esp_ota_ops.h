@@ -0,0 +1,38 @@
+/*
+ * esp_ota_ops.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the ESP-IDF header of the same name. The device runs from ota_0 and updates ota_1.
+ */
+
+#ifndef TEST_IDF_SHIM_ESP_OTA_OPS_H_
+#define TEST_IDF_SHIM_ESP_OTA_OPS_H_
+
+#include "esp_app_desc.h"
+#include "esp_err.h"
+#include "esp_image_format.h"
+#include "esp_partition.h"
+
+#define ESP_ERR_OTA_BASE				0x1500
+#define ESP_ERR_OTA_PARTITION_CONFLICT	(ESP_ERR_OTA_BASE + 0x01)
+#define ESP_ERR_OTA_SELECT_INFO_INVALID	(ESP_ERR_OTA_BASE + 0x02)
+#define ESP_ERR_OTA_VALIDATE_FAILED		(ESP_ERR_OTA_BASE + 0x03)
+
+typedef enum
+{
+	ESP_OTA_IMG_NEW = 0x0U,
+	ESP_OTA_IMG_PENDING_VERIFY = 0x1U,
+	ESP_OTA_IMG_VALID = 0x2U,
+	ESP_OTA_IMG_INVALID = 0x3U,
+	ESP_OTA_IMG_ABORTED = 0x4U,
+	ESP_OTA_IMG_UNDEFINED = 0xFFFFFFFFU,
+} esp_ota_img_states_t;
+
+const esp_partition_t *esp_ota_get_running_partition(void);
+const esp_partition_t *esp_ota_get_boot_partition(void);
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start_from);
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition);
+esp_err_t esp_ota_get_state_partition(const esp_partition_t *partition, esp_ota_img_states_t *ota_state);
+
+#endif /* TEST_IDF_SHIM_ESP_OTA_OPS_H_ */
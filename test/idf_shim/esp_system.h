@@ -0,0 +1,17 @@
+/*
+ * esp_system.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the ESP-IDF header of the same name.
+ */
+
+#ifndef TEST_IDF_SHIM_ESP_SYSTEM_H_
+#define TEST_IDF_SHIM_ESP_SYSTEM_H_
+
+/**
+ * Ends the host build, a restart is never expected while it runs.
+ */
+void esp_restart(void) __attribute__((noreturn));
+
+#endif /* TEST_IDF_SHIM_ESP_SYSTEM_H_ */
@@ -0,0 +1,48 @@
+/*
+ * esp_timer.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the ESP-IDF header of the same name. Timers can be created and started but never fire,
+ * so e.g. the restart after a successful update does not end the benchmark.
+ */
+
+#ifndef TEST_IDF_SHIM_ESP_TIMER_H_
+#define TEST_IDF_SHIM_ESP_TIMER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef struct esp_timer *esp_timer_handle_t;
+
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum
+{
+	ESP_TIMER_TASK,
+	ESP_TIMER_ISR,
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+	esp_timer_cb_t callback;
+	void *arg;
+	esp_timer_dispatch_t dispatch_method;
+	const char *name;
+	bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+
+/**
+ * Gets the time since the host build started.
+ * @return time in microseconds.
+ */
+int64_t esp_timer_get_time(void);
+
+#endif /* TEST_IDF_SHIM_ESP_TIMER_H_ */
@@ -0,0 +1,19 @@
+/*
+ * esp_wifi_types.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the ESP-IDF header of the same name, only the types the firmware headers need.
+ */
+
+#ifndef TEST_IDF_SHIM_ESP_WIFI_TYPES_H_
+#define TEST_IDF_SHIM_ESP_WIFI_TYPES_H_
+
+#include <stdint.h>
+
+typedef union
+{
+	uint8_t raw[132];
+} wifi_config_t;
+
+#endif /* TEST_IDF_SHIM_ESP_WIFI_TYPES_H_ */
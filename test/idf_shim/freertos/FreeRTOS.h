@@ -0,0 +1,35 @@
+/*
+ * FreeRTOS.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the FreeRTOS header of the same name. Tasks are threads, see idf_shim_freertos.c,
+ * priorities and core affinity are ignored.
+ */
+
+#ifndef TEST_IDF_SHIM_FREERTOS_FREERTOS_H_
+#define TEST_IDF_SHIM_FREERTOS_FREERTOS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE					((BaseType_t)0)
+#define pdTRUE					((BaseType_t)1)
+#define pdFAIL					pdFALSE
+#define pdPASS					pdTRUE
+
+#define portMAX_DELAY			((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ		CONFIG_FREERTOS_HZ
+#define portTICK_PERIOD_MS		((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)		((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000U))
+#define portNUM_PROCESSORS		2
+#define tskNO_AFFINITY			((BaseType_t)0x7FFFFFFF)
+
+#endif /* TEST_IDF_SHIM_FREERTOS_FREERTOS_H_ */
@@ -0,0 +1,25 @@
+/*
+ * queue.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the FreeRTOS header of the same name.
+ */
+
+#ifndef TEST_IDF_SHIM_FREERTOS_QUEUE_H_
+#define TEST_IDF_SHIM_FREERTOS_QUEUE_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct idf_shim_queue *QueueHandle_t;
+
+/**
+ * Creates a queue, its storage is allocated from the heap like on the device.
+ */
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize);
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait);
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue);
+void vQueueDelete(QueueHandle_t xQueue);
+
+#endif /* TEST_IDF_SHIM_FREERTOS_QUEUE_H_ */
@@ -0,0 +1,26 @@
+/*
+ * semphr.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the FreeRTOS header of the same name. As in FreeRTOS a semaphore is a queue of items without data,
+ * mutexes have no priority inheritance.
+ */
+
+#ifndef TEST_IDF_SHIM_FREERTOS_SEMPHR_H_
+#define TEST_IDF_SHIM_FREERTOS_SEMPHR_H_
+
+#include "freertos/queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount);
+
+#define xSemaphoreTake(xSemaphore, xBlockTime)	xQueueReceive((xSemaphore), NULL, (xBlockTime))
+#define xSemaphoreGive(xSemaphore)				xQueueSend((xSemaphore), NULL, 0)
+#define uxSemaphoreGetCount(xSemaphore)			uxQueueMessagesWaiting(xSemaphore)
+#define vSemaphoreDelete(xSemaphore)			vQueueDelete(xSemaphore)
+
+#endif /* TEST_IDF_SHIM_FREERTOS_SEMPHR_H_ */
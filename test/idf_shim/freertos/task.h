@@ -0,0 +1,36 @@
+/*
+ * task.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the FreeRTOS header of the same name.
+ */
+
+#ifndef TEST_IDF_SHIM_FREERTOS_TASK_H_
+#define TEST_IDF_SHIM_FREERTOS_TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct idf_shim_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+/**
+ * Starts a task on a thread of its own. The stack is counted as heap, as ESP-IDF allocates it there.
+ */
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth, void *pvParameters,
+		UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask, BaseType_t xCoreID);
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth, void *pvParameters,
+		UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask);
+
+/**
+ * Ends a task. Only the calling task can be deleted, i.e. xTaskToDelete must be NULL or the calling task.
+ */
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+
+void vTaskDelay(TickType_t xTicksToDelay);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+
+#endif /* TEST_IDF_SHIM_FREERTOS_TASK_H_ */
@@ -0,0 +1,168 @@
+/*
+ * idf_shim.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-ins for the parts of ESP-IDF, FreeRTOS and mbedtls the OTA receive and write path uses, so the firmware
+ * sources themselves can be built and benchmarked on the host:
+ * - a flash emulator with NOR semantics and erase, program and read timings behind esp_partition_*,
+ * - a socket stand-in behind httpd_req_recv, replaying a trace of TCP segments with latency, loss and a receive window,
+ * - FreeRTOS tasks, queues and semaphores on threads,
+ * - heap accounting of every allocation, task stacks included.
+ * Emulated delays are slept, so the firmware's tasks overlap with them as they do on the device.
+ * Flash operations only block the calling task: the cache stall of the other core is not emulated.
+ */
+
+#ifndef TEST_IDF_SHIM_IDF_SHIM_H_
+#define TEST_IDF_SHIM_IDF_SHIM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+
+// Emulated device
+#define IDF_SHIM_PARTITION_SIZE		0x200000		// Size of the ota_0 and ota_1 partitions
+#define IDF_SHIM_RUNNING_VERSION	"1.0.0"			// Version of the running application
+#define IDF_SHIM_MAX_HEADERS		8				// Request headers idf_shim_httpd_run passes on
+#define IDF_SHIM_RESPONSE_SIZE		256				// Bytes of a response body kept for the caller
+
+/**
+ * Timings of the emulated flash chip in microseconds
+ */
+typedef struct idf_shim_flash_timing
+{
+	uint32_t sector_erase_us;			///> Erasing a 4 KB sector
+	uint32_t block_erase_us;			///> Erasing a 64 KB block
+	uint32_t page_program_us;			///> Programming a 256 byte page
+	uint32_t read_kb_us;				///> Reading 1 KB
+} idf_shim_flash_timing_t;
+
+/**
+ * Work done by the emulated flash chip
+ */
+typedef struct idf_shim_flash_stats
+{
+	uint32_t sector_erases;
+	uint32_t block_erases;
+	uint32_t pages_programmed;
+	uint32_t kb_read;
+	uint64_t busy_us;					///> Emulated time the chip was busy
+} idf_shim_flash_stats_t;
+
+/**
+ * TCP segment of a socket trace
+ */
+typedef struct idf_shim_segment
+{
+	uint32_t gap_us;					///> Time the sender needs after the previous segment, i.e. the link rate
+	uint32_t len;						///> Payload bytes
+	uint32_t delay_us;					///> Extra delay on top of the latency, e.g. the retransmission timeout of a lost segment
+} idf_shim_segment_t;
+
+/**
+ * Socket the body of a request is received from
+ */
+typedef struct idf_shim_socket
+{
+	const idf_shim_segment_t *trace;	///> Segments, replayed from the start again if the body is longer
+	size_t trace_len;					///> Number of segments in trace
+	uint32_t latency_us;				///> One-way latency, an ACK takes as long to reach the sender
+	uint32_t window;					///> TCP receive window, the sender stops while this much is unread
+} idf_shim_socket_t;
+
+/**
+ * Request run by idf_shim_httpd_run, and its outcome
+ */
+typedef struct idf_shim_request
+{
+	httpd_method_t method;
+	const char *uri;
+	const char *headers[IDF_SHIM_MAX_HEADERS][2];	///> Name and value pairs, the unused ones NULL
+	const uint8_t *body;
+	size_t body_len;
+	const idf_shim_socket_t *socket;
+
+	uint32_t *latency_us;				///> Set to the time each segment waited in the socket until it was read completely
+	size_t latency_cap;					///> Number of entries latency_us has room for
+	size_t latency_count;				///> Number of segments read
+
+	char status[48];					///> Status line of the response
+	char response[IDF_SHIM_RESPONSE_SIZE];	///> Start of the response body
+	bool closed;						///> The connection was closed instead of being kept alive
+} idf_shim_request_t;
+
+/**
+ * Scales every emulated delay, e.g. 0.1 runs the flash and the network ten times faster than the device.
+ * @param scale factor, 1 for the device timings.
+ */
+void idf_shim_set_time_scale(double scale);
+
+/**
+ * Sleeps for an emulated delay, scaled by the time scale.
+ * @param us delay in microseconds.
+ */
+void idf_shim_delay_us(uint64_t us);
+
+/**
+ * Sleeps until a point in time.
+ * @param at time as returned by esp_timer_get_time.
+ */
+void idf_shim_sleep_until(int64_t at);
+
+/**
+ * Sets the most detailed level of the log messages printed.
+ */
+void idf_shim_set_log_level(esp_log_level_t level);
+
+/**
+ * Sets up the flash emulator. Both partitions start out erased, boot and running partition are ota_0.
+ * @param timing timings of the flash chip.
+ */
+void idf_shim_flash_init(const idf_shim_flash_timing_t *timing);
+
+/**
+ * Gets the contents of an emulated partition, for setting it up and checking it without emulated delays.
+ */
+uint8_t *idf_shim_flash_contents(const esp_partition_t *partition);
+
+/**
+ * Gets the work done by the flash chip since the last idf_shim_flash_reset_stats.
+ */
+void idf_shim_flash_get_stats(idf_shim_flash_stats_t *stats);
+void idf_shim_flash_reset_stats(void);
+
+/**
+ * Sets the boot partition back to ota_0 and clears NVS, as on a device which never saw an update.
+ */
+void idf_shim_ota_reset(void);
+
+/**
+ * Dispatches a request to the handler the firmware registered for it, on the calling thread as the server task would,
+ * then waits until the request is answered and its connection released, also when the handler hands it to an async worker.
+ * @param request request to run, its outcome is stored in it.
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if no handler matches, ESP_ERR_INVALID_STATE if the server is not running.
+ */
+esp_err_t idf_shim_httpd_run(idf_shim_request_t *request);
+
+/**
+ * Starts a new heap peak at the current heap usage.
+ */
+void idf_shim_heap_reset_peak(void);
+
+/**
+ * Gets the highest heap usage since idf_shim_heap_reset_peak, above the usage at that time.
+ * @return bytes.
+ */
+size_t idf_shim_heap_peak(void);
+
+/**
+ * Counts memory which is allocated from the heap on the device but not on the host, e.g. task stacks.
+ * @param bytes size of the allocation, negative when it is released.
+ */
+void idf_shim_heap_track(long bytes);
+
+#endif /* TEST_IDF_SHIM_IDF_SHIM_H_ */
@@ -0,0 +1,521 @@
+/*
+ * idf_shim_flash.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Flash emulator behind esp_partition_*, with the OTA, image and NVS functions built on it.
+ * Like NOR flash, erasing sets every bit and programming only clears bits, so data written over
+ * data which was not erased comes out wrong just as on the device.
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include "esp_app_desc.h"
+#include "esp_image_format.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "idf_shim.h"
+#include "mbedtls/sha256.h"
+#include "nvs.h"
+
+// Flash geometry
+#define IDF_SHIM_FLASH_BLOCK_SIZE	65536
+#define IDF_SHIM_FLASH_PAGE_SIZE	256
+
+// NVS capacity
+#define IDF_SHIM_NVS_NAMESPACES		8
+#define IDF_SHIM_NVS_ENTRIES		16
+#define IDF_SHIM_NVS_NAME_SIZE		16			// Longest name and key, with the terminator
+#define IDF_SHIM_NVS_BLOB_SIZE		4096
+
+/**
+ * Blob stored in NVS
+ */
+typedef struct idf_shim_nvs_entry
+{
+	uint32_t handle;							///> Namespace the entry belongs to, 0 if the entry is free
+	char key[IDF_SHIM_NVS_NAME_SIZE];
+	size_t len;
+	uint8_t blob[IDF_SHIM_NVS_BLOB_SIZE];
+} idf_shim_nvs_entry_t;
+
+// Application partitions, the device runs from ota_0
+static esp_partition_t idf_shim_partitions[] = {
+		{ .type = ESP_PARTITION_TYPE_APP, .subtype = ESP_PARTITION_SUBTYPE_APP_OTA_0, .address = 0x20000,
+				.size = IDF_SHIM_PARTITION_SIZE, .erase_size = SPI_FLASH_SEC_SIZE, .label = "ota_0" },
+		{ .type = ESP_PARTITION_TYPE_APP, .subtype = ESP_PARTITION_SUBTYPE_APP_OTA_1, .address = 0x20000 + IDF_SHIM_PARTITION_SIZE,
+				.size = IDF_SHIM_PARTITION_SIZE, .erase_size = SPI_FLASH_SEC_SIZE, .label = "ota_1" },
+};
+
+#define IDF_SHIM_PARTITION_COUNT	(sizeof(idf_shim_partitions) / sizeof(idf_shim_partitions[0]))
+
+// Contents of the partitions
+static uint8_t idf_shim_flash[IDF_SHIM_PARTITION_COUNT][IDF_SHIM_PARTITION_SIZE];
+
+// Only one flash operation runs at a time, as on the SPI bus
+static pthread_mutex_t idf_shim_flash_lock = PTHREAD_MUTEX_INITIALIZER;
+static idf_shim_flash_timing_t idf_shim_flash_timing;
+static idf_shim_flash_stats_t idf_shim_flash_stats;
+
+// Partition the bootloader starts next
+static const esp_partition_t *idf_shim_boot_partition = &idf_shim_partitions[0];
+
+// NVS namespaces, a handle is the index of its namespace plus one, and the stored entries
+static pthread_mutex_t idf_shim_nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+static char idf_shim_nvs_namespaces[IDF_SHIM_NVS_NAMESPACES][IDF_SHIM_NVS_NAME_SIZE];
+static idf_shim_nvs_entry_t idf_shim_nvs[IDF_SHIM_NVS_ENTRIES];
+
+/**
+ * Gets the index of a partition of the emulator.
+ * @return index, -1 if the partition is not one of the emulator.
+ */
+static int idf_shim_partition_index(const esp_partition_t *partition)
+{
+	for (size_t i = 0; i < IDF_SHIM_PARTITION_COUNT; i++)
+	{
+		if (partition == &idf_shim_partitions[i])
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * Keeps the flash chip busy for a while. Called with the flash lock held.
+ * @param us emulated time in microseconds.
+ */
+static void idf_shim_flash_busy(uint64_t us)
+{
+	idf_shim_flash_stats.busy_us += us;
+	idf_shim_delay_us(us);
+}
+
+void idf_shim_flash_init(const idf_shim_flash_timing_t *timing)
+{
+	idf_shim_flash_timing = *timing;
+	memset(idf_shim_flash, 0xFF, sizeof(idf_shim_flash));
+	idf_shim_flash_reset_stats();
+	idf_shim_ota_reset();
+}
+
+uint8_t *idf_shim_flash_contents(const esp_partition_t *partition)
+{
+	int index = idf_shim_partition_index(partition);
+
+	return (index >= 0) ? idf_shim_flash[index] : NULL;
+}
+
+void idf_shim_flash_get_stats(idf_shim_flash_stats_t *stats)
+{
+	pthread_mutex_lock(&idf_shim_flash_lock);
+	*stats = idf_shim_flash_stats;
+	pthread_mutex_unlock(&idf_shim_flash_lock);
+}
+
+void idf_shim_flash_reset_stats(void)
+{
+	pthread_mutex_lock(&idf_shim_flash_lock);
+	memset(&idf_shim_flash_stats, 0, sizeof(idf_shim_flash_stats));
+	pthread_mutex_unlock(&idf_shim_flash_lock);
+}
+
+void idf_shim_ota_reset(void)
+{
+	idf_shim_boot_partition = &idf_shim_partitions[0];
+
+	pthread_mutex_lock(&idf_shim_nvs_lock);
+	memset(idf_shim_nvs, 0, sizeof(idf_shim_nvs));
+	pthread_mutex_unlock(&idf_shim_nvs_lock);
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+	int index = idf_shim_partition_index(partition);
+
+	if (index < 0 || dst == NULL)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (src_offset > partition->size || size > partition->size - src_offset)
+	{
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	pthread_mutex_lock(&idf_shim_flash_lock);
+	memcpy(dst, &idf_shim_flash[index][src_offset], size);
+	idf_shim_flash_stats.kb_read += (size + 1023) / 1024;
+	idf_shim_flash_busy((uint64_t)size * idf_shim_flash_timing.read_kb_us / 1024);
+	pthread_mutex_unlock(&idf_shim_flash_lock);
+
+	return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+	int index = idf_shim_partition_index(partition);
+	const uint8_t *data = src;
+
+	if (index < 0 || src == NULL)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (dst_offset > partition->size || size > partition->size - dst_offset)
+	{
+		return ESP_ERR_INVALID_SIZE;
+	}
+	if (size == 0)
+	{
+		return ESP_OK;
+	}
+
+	pthread_mutex_lock(&idf_shim_flash_lock);
+	for (size_t i = 0; i < size; i++)
+	{
+		idf_shim_flash[index][dst_offset + i] &= data[i];
+	}
+
+	// Every page the data touches is programmed on its own
+	uint32_t pages = (dst_offset + size - 1) / IDF_SHIM_FLASH_PAGE_SIZE - dst_offset / IDF_SHIM_FLASH_PAGE_SIZE + 1;
+	idf_shim_flash_stats.pages_programmed += pages;
+	idf_shim_flash_busy((uint64_t)pages * idf_shim_flash_timing.page_program_us);
+	pthread_mutex_unlock(&idf_shim_flash_lock);
+
+	return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+	int index = idf_shim_partition_index(partition);
+
+	if (index < 0 || offset % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (offset > partition->size || size > partition->size - offset)
+	{
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	// As the flash driver, whole aligned blocks are erased with the block erase command
+	pthread_mutex_lock(&idf_shim_flash_lock);
+	while (size > 0)
+	{
+		size_t len;
+
+		if ((partition->address + offset) % IDF_SHIM_FLASH_BLOCK_SIZE == 0 && size >= IDF_SHIM_FLASH_BLOCK_SIZE)
+		{
+			len = IDF_SHIM_FLASH_BLOCK_SIZE;
+			idf_shim_flash_stats.block_erases++;
+			idf_shim_flash_busy(idf_shim_flash_timing.block_erase_us);
+		}
+		else
+		{
+			len = SPI_FLASH_SEC_SIZE;
+			idf_shim_flash_stats.sector_erases++;
+			idf_shim_flash_busy(idf_shim_flash_timing.sector_erase_us);
+		}
+		memset(&idf_shim_flash[index][offset], 0xFF, len);
+		offset += len;
+		size -= len;
+	}
+	pthread_mutex_unlock(&idf_shim_flash_lock);
+
+	return ESP_OK;
+}
+
+const esp_partition_t *esp_ota_get_running_partition(void)
+{
+	return &idf_shim_partitions[0];
+}
+
+const esp_partition_t *esp_ota_get_boot_partition(void)
+{
+	return idf_shim_boot_partition;
+}
+
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start_from)
+{
+	int index = idf_shim_partition_index((start_from != NULL) ? start_from : esp_ota_get_running_partition());
+
+	return (index >= 0) ? &idf_shim_partitions[(index + 1) % IDF_SHIM_PARTITION_COUNT] : NULL;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
+{
+	if (idf_shim_partition_index(partition) < 0)
+	{
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	// The otadata sector is erased and a new entry programmed
+	pthread_mutex_lock(&idf_shim_flash_lock);
+	idf_shim_flash_stats.sector_erases++;
+	idf_shim_flash_stats.pages_programmed++;
+	idf_shim_flash_busy(idf_shim_flash_timing.sector_erase_us + idf_shim_flash_timing.page_program_us);
+	idf_shim_boot_partition = partition;
+	pthread_mutex_unlock(&idf_shim_flash_lock);
+
+	return ESP_OK;
+}
+
+esp_err_t esp_ota_get_state_partition(const esp_partition_t *partition, esp_ota_img_states_t *ota_state)
+{
+	if (idf_shim_partition_index(partition) < 0)
+	{
+		return ESP_ERR_NOT_FOUND;
+	}
+	*ota_state = ESP_OTA_IMG_VALID;
+
+	return ESP_OK;
+}
+
+const esp_app_desc_t *esp_app_get_description(void)
+{
+	static const esp_app_desc_t app_desc = {
+			.magic_word = ESP_APP_DESC_MAGIC_WORD,
+			.version = IDF_SHIM_RUNNING_VERSION,
+			.project_name = "OTA_UPDATE",
+	};
+
+	return &app_desc;
+}
+
+/**
+ * Walks the segment headers of the image in a partition.
+ * @param part position of the partition.
+ * @param metadata set to the header, the segments and the length of the image.
+ * @return index of the partition, -1 if there is no valid image at part.
+ */
+static int idf_shim_image_walk(const esp_partition_pos_t *part, esp_image_metadata_t *metadata)
+{
+	int index = -1;
+
+	for (size_t i = 0; i < IDF_SHIM_PARTITION_COUNT; i++)
+	{
+		if (idf_shim_partitions[i].address == part->offset && idf_shim_partitions[i].size == part->size)
+		{
+			index = i;
+		}
+	}
+	if (index < 0)
+	{
+		return -1;
+	}
+
+	const uint8_t *flash = idf_shim_flash[index];
+	size_t pos = sizeof(esp_image_header_t);
+
+	memset(metadata, 0, sizeof(*metadata));
+	metadata->start_addr = part->offset;
+	memcpy(&metadata->image, flash, sizeof(metadata->image));
+	if (metadata->image.magic != ESP_IMAGE_HEADER_MAGIC || metadata->image.segment_count == 0 ||
+		metadata->image.segment_count > ESP_IMAGE_MAX_SEGMENTS)
+	{
+		return -1;
+	}
+
+	for (int i = 0; i < metadata->image.segment_count; i++)
+	{
+		if (part->size - pos < sizeof(esp_image_segment_header_t))
+		{
+			return -1;
+		}
+		memcpy(&metadata->segments[i], &flash[pos], sizeof(esp_image_segment_header_t));
+		pos += sizeof(esp_image_segment_header_t);
+		if (metadata->segments[i].data_len > part->size - pos)
+		{
+			return -1;
+		}
+		metadata->segment_data[i] = part->offset + pos;
+		pos += metadata->segments[i].data_len;
+	}
+	metadata->image_len = pos;
+
+	return index;
+}
+
+esp_err_t esp_image_get_metadata(const esp_partition_pos_t *part, esp_image_metadata_t *metadata)
+{
+	return (idf_shim_image_walk(part, metadata) >= 0) ? ESP_OK : ESP_ERR_IMAGE_INVALID;
+}
+
+esp_err_t esp_image_verify(esp_image_load_mode_t mode, const esp_partition_pos_t *part, esp_image_metadata_t *data)
+{
+	mbedtls_sha256_context sha256;
+	int index = idf_shim_image_walk(part, data);
+
+	(void)mode;
+
+	if (index < 0)
+	{
+		return ESP_ERR_IMAGE_INVALID;
+	}
+
+	// The whole image is read back and hashed
+	pthread_mutex_lock(&idf_shim_flash_lock);
+	idf_shim_flash_stats.kb_read += (data->image_len + 1023) / 1024;
+	idf_shim_flash_busy((uint64_t)data->image_len * idf_shim_flash_timing.read_kb_us / 1024);
+	pthread_mutex_unlock(&idf_shim_flash_lock);
+
+	mbedtls_sha256_init(&sha256);
+	mbedtls_sha256_starts(&sha256, 0);
+	mbedtls_sha256_update(&sha256, idf_shim_flash[index], data->image_len);
+	mbedtls_sha256_finish(&sha256, data->image_digest);
+	mbedtls_sha256_free(&sha256);
+
+	return ESP_OK;
+}
+
+/**
+ * Finds an NVS entry. Called with the NVS lock held.
+ * @return entry, NULL if there is none.
+ */
+static idf_shim_nvs_entry_t *idf_shim_nvs_find(nvs_handle_t handle, const char *key)
+{
+	for (size_t i = 0; i < IDF_SHIM_NVS_ENTRIES; i++)
+	{
+		if (idf_shim_nvs[i].handle == handle && strcmp(idf_shim_nvs[i].key, key) == 0)
+		{
+			return &idf_shim_nvs[i];
+		}
+	}
+
+	return NULL;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+	esp_err_t err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+
+	if (strlen(namespace_name) >= IDF_SHIM_NVS_NAME_SIZE)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	pthread_mutex_lock(&idf_shim_nvs_lock);
+	for (size_t i = 0; i < IDF_SHIM_NVS_NAMESPACES; i++)
+	{
+		if (strcmp(idf_shim_nvs_namespaces[i], namespace_name) == 0 ||
+			(idf_shim_nvs_namespaces[i][0] == '\0' && open_mode == NVS_READWRITE))
+		{
+			strcpy(idf_shim_nvs_namespaces[i], namespace_name);
+			*out_handle = i + 1;
+			err = ESP_OK;
+			break;
+		}
+		if (idf_shim_nvs_namespaces[i][0] == '\0')
+		{
+			// A namespace which does not exist cannot be opened read-only
+			err = ESP_ERR_NVS_NOT_FOUND;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&idf_shim_nvs_lock);
+
+	return err;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+	(void)handle;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+	(void)handle;
+
+	return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+	esp_err_t err = ESP_OK;
+
+	if (handle == 0 || handle > IDF_SHIM_NVS_NAMESPACES)
+	{
+		return ESP_ERR_NVS_INVALID_HANDLE;
+	}
+	if (strlen(key) >= IDF_SHIM_NVS_NAME_SIZE || length > IDF_SHIM_NVS_BLOB_SIZE)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	pthread_mutex_lock(&idf_shim_nvs_lock);
+	idf_shim_nvs_entry_t *entry = idf_shim_nvs_find(handle, key);
+	if (entry == NULL)
+	{
+		entry = idf_shim_nvs_find(0, "");
+	}
+	if (entry != NULL)
+	{
+		entry->handle = handle;
+		strcpy(entry->key, key);
+		memcpy(entry->blob, value, length);
+		entry->len = length;
+	}
+	else
+	{
+		err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+	}
+	pthread_mutex_unlock(&idf_shim_nvs_lock);
+
+	// NVS appends the blob to its pages in flash
+	if (err == ESP_OK)
+	{
+		pthread_mutex_lock(&idf_shim_flash_lock);
+		uint32_t pages = (length + IDF_SHIM_FLASH_PAGE_SIZE - 1) / IDF_SHIM_FLASH_PAGE_SIZE + 1;
+		idf_shim_flash_stats.pages_programmed += pages;
+		idf_shim_flash_busy((uint64_t)pages * idf_shim_flash_timing.page_program_us);
+		pthread_mutex_unlock(&idf_shim_flash_lock);
+	}
+
+	return err;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+	esp_err_t err = ESP_OK;
+
+	pthread_mutex_lock(&idf_shim_nvs_lock);
+	idf_shim_nvs_entry_t *entry = idf_shim_nvs_find(handle, key);
+	if (entry == NULL)
+	{
+		err = ESP_ERR_NVS_NOT_FOUND;
+	}
+	else if (out_value == NULL)
+	{
+		*length = entry->len;
+	}
+	else if (*length < entry->len)
+	{
+		*length = entry->len;
+		err = ESP_ERR_NVS_INVALID_LENGTH;
+	}
+	else
+	{
+		memcpy(out_value, entry->blob, entry->len);
+		*length = entry->len;
+	}
+	pthread_mutex_unlock(&idf_shim_nvs_lock);
+
+	return err;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+	esp_err_t err = ESP_ERR_NVS_NOT_FOUND;
+
+	pthread_mutex_lock(&idf_shim_nvs_lock);
+	idf_shim_nvs_entry_t *entry = idf_shim_nvs_find(handle, key);
+	if (entry != NULL)
+	{
+		memset(entry, 0, sizeof(*entry));
+		err = ESP_OK;
+	}
+	pthread_mutex_unlock(&idf_shim_nvs_lock);
+
+	return err;
+}
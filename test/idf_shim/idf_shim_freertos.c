@@ -0,0 +1,365 @@
+/*
+ * idf_shim_freertos.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * FreeRTOS tasks, queues, semaphores and task notifications on POSIX threads.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "idf_shim.h"
+
+// Heap taken by a task control block on the device, next to its stack
+#define IDF_SHIM_TCB_SIZE		352
+
+/**
+ * Task, running on a thread of its own
+ */
+struct idf_shim_task
+{
+	TaskFunction_t code;
+	void *parameters;
+	uint32_t stack_size;
+	pthread_mutex_t lock;
+	pthread_cond_t notified;
+	uint32_t notify_value;
+};
+
+/**
+ * Queue, and with item_size 0 a semaphore
+ */
+struct idf_shim_queue
+{
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+	size_t length;
+	size_t item_size;
+	size_t count;
+	size_t head;
+	uint8_t storage[];
+};
+
+// Task of the calling thread, the main thread gets one on its first use
+static __thread struct idf_shim_task *idf_shim_current_task = NULL;
+
+/**
+ * Initializes a condition variable waiting on the monotonic clock.
+ */
+static void idf_shim_cond_init(pthread_cond_t *cond)
+{
+	pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+/**
+ * Gets the point in time a wait of a number of ticks ends at.
+ */
+static struct timespec idf_shim_deadline(TickType_t ticks)
+{
+	struct timespec deadline;
+	uint64_t ns = (uint64_t)ticks * (1000000000 / configTICK_RATE_HZ);
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += ns / 1000000000;
+	deadline.tv_nsec += ns % 1000000000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	return deadline;
+}
+
+/**
+ * Waits on a condition variable for at most a number of ticks.
+ * @return true if woken, false if the time is up.
+ */
+static bool idf_shim_cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t ticks, const struct timespec *deadline)
+{
+	if (ticks == portMAX_DELAY)
+	{
+		pthread_cond_wait(cond, lock);
+		return true;
+	}
+
+	return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+/**
+ * Creates the state of a task, without its thread.
+ */
+static struct idf_shim_task *idf_shim_task_new(TaskFunction_t code, void *parameters, uint32_t stack_size)
+{
+	struct idf_shim_task *task = calloc(1, sizeof(*task));
+
+	if (task != NULL)
+	{
+		task->code = code;
+		task->parameters = parameters;
+		task->stack_size = stack_size;
+		pthread_mutex_init(&task->lock, NULL);
+		idf_shim_cond_init(&task->notified);
+	}
+
+	return task;
+}
+
+/**
+ * Thread of a task.
+ */
+static void *idf_shim_task_main(void *arg)
+{
+	struct idf_shim_task *task = arg;
+
+	idf_shim_current_task = task;
+	task->code(task->parameters);
+
+	// A FreeRTOS task must not return, deleting itself is the closest
+	vTaskDelete(NULL);
+
+	return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth, void *pvParameters,
+		UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask, BaseType_t xCoreID)
+{
+	struct idf_shim_task *task = idf_shim_task_new(pxTaskCode, pvParameters, usStackDepth);
+	pthread_attr_t attr;
+	pthread_t thread;
+
+	(void)pcName;
+	(void)uxPriority;
+	(void)xCoreID;
+
+	if (task == NULL)
+	{
+		return pdFAIL;
+	}
+
+	// The stack and the control block come from the heap on the device
+	idf_shim_heap_track(usStackDepth + IDF_SHIM_TCB_SIZE);
+
+	// The handle is known before the task runs, as on the device
+	if (pxCreatedTask != NULL)
+	{
+		*pxCreatedTask = task;
+	}
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (pthread_create(&thread, &attr, idf_shim_task_main, task) != 0)
+	{
+		fprintf(stderr, "xTaskCreatePinnedToCore: Cannot start a thread\n");
+		abort();
+	}
+	pthread_attr_destroy(&attr);
+
+	return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth, void *pvParameters,
+		UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask)
+{
+	return xTaskCreatePinnedToCore(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+	struct idf_shim_task *task = xTaskGetCurrentTaskHandle();
+
+	if (xTaskToDelete != NULL && xTaskToDelete != task)
+	{
+		fprintf(stderr, "vTaskDelete: Only the calling task can be deleted on the host\n");
+		abort();
+	}
+
+	idf_shim_heap_track(-(long)(task->stack_size + IDF_SHIM_TCB_SIZE));
+	idf_shim_current_task = NULL;
+	pthread_mutex_destroy(&task->lock);
+	pthread_cond_destroy(&task->notified);
+	free(task);
+	pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t xTicksToDelay)
+{
+	struct timespec deadline = idf_shim_deadline(xTicksToDelay);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+	{
+	}
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	return (TickType_t)(esp_timer_get_time() / (1000000 / configTICK_RATE_HZ));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	if (idf_shim_current_task == NULL)
+	{
+		idf_shim_current_task = idf_shim_task_new(NULL, NULL, 0);
+	}
+
+	return idf_shim_current_task;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+	pthread_mutex_lock(&xTaskToNotify->lock);
+	xTaskToNotify->notify_value++;
+	pthread_cond_signal(&xTaskToNotify->notified);
+	pthread_mutex_unlock(&xTaskToNotify->lock);
+
+	return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+	struct idf_shim_task *task = xTaskGetCurrentTaskHandle();
+	struct timespec deadline = idf_shim_deadline(xTicksToWait);
+	uint32_t value;
+
+	pthread_mutex_lock(&task->lock);
+	while (task->notify_value == 0 && xTicksToWait > 0 && idf_shim_cond_wait(&task->notified, &task->lock, xTicksToWait, &deadline))
+	{
+	}
+	value = task->notify_value;
+	if (value > 0)
+	{
+		task->notify_value = xClearCountOnExit ? 0 : value - 1;
+	}
+	pthread_mutex_unlock(&task->lock);
+
+	return value;
+}
+
+/**
+ * Creates a queue holding count of its length items already, for the semaphores.
+ */
+static QueueHandle_t idf_shim_queue_new(UBaseType_t length, UBaseType_t item_size, UBaseType_t count)
+{
+	struct idf_shim_queue *queue = malloc(sizeof(*queue) + (size_t)length * item_size);
+
+	if (queue != NULL)
+	{
+		pthread_mutex_init(&queue->lock, NULL);
+		idf_shim_cond_init(&queue->not_empty);
+		idf_shim_cond_init(&queue->not_full);
+		queue->length = length;
+		queue->item_size = item_size;
+		queue->count = count;
+		queue->head = 0;
+	}
+
+	return queue;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+	return idf_shim_queue_new(uxQueueLength, uxItemSize, 0);
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+	struct timespec deadline = idf_shim_deadline(xTicksToWait);
+
+	pthread_mutex_lock(&xQueue->lock);
+	while (xQueue->count == xQueue->length)
+	{
+		if (xTicksToWait == 0 || !idf_shim_cond_wait(&xQueue->not_full, &xQueue->lock, xTicksToWait, &deadline))
+		{
+			pthread_mutex_unlock(&xQueue->lock);
+			return pdFAIL;
+		}
+	}
+
+	if (xQueue->item_size > 0)
+	{
+		size_t tail = (xQueue->head + xQueue->count) % xQueue->length;
+		memcpy(&xQueue->storage[tail * xQueue->item_size], pvItemToQueue, xQueue->item_size);
+	}
+	xQueue->count++;
+	pthread_cond_signal(&xQueue->not_empty);
+	pthread_mutex_unlock(&xQueue->lock);
+
+	return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+	struct timespec deadline = idf_shim_deadline(xTicksToWait);
+
+	pthread_mutex_lock(&xQueue->lock);
+	while (xQueue->count == 0)
+	{
+		if (xTicksToWait == 0 || !idf_shim_cond_wait(&xQueue->not_empty, &xQueue->lock, xTicksToWait, &deadline))
+		{
+			pthread_mutex_unlock(&xQueue->lock);
+			return pdFAIL;
+		}
+	}
+
+	if (xQueue->item_size > 0)
+	{
+		memcpy(pvBuffer, &xQueue->storage[xQueue->head * xQueue->item_size], xQueue->item_size);
+		xQueue->head = (xQueue->head + 1) % xQueue->length;
+	}
+	xQueue->count--;
+	pthread_cond_signal(&xQueue->not_full);
+	pthread_mutex_unlock(&xQueue->lock);
+
+	return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+	UBaseType_t count;
+
+	pthread_mutex_lock(&xQueue->lock);
+	count = xQueue->count;
+	pthread_mutex_unlock(&xQueue->lock);
+
+	return count;
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+	pthread_mutex_destroy(&xQueue->lock);
+	pthread_cond_destroy(&xQueue->not_empty);
+	pthread_cond_destroy(&xQueue->not_full);
+	free(xQueue);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+	return idf_shim_queue_new(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+	return idf_shim_queue_new(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount)
+{
+	return idf_shim_queue_new(uxMaxCount, 0, uxInitialCount);
+}
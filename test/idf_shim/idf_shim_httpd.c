@@ -0,0 +1,564 @@
+/*
+ * idf_shim_httpd.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * HTTP server stand-in: dispatches requests to the registered handlers and receives their bodies from a socket
+ * which replays a trace of TCP segments. A segment is sent once the sender is through with the previous one and
+ * the receive window has room for it, and arrives a latency later, plus its extra delay. Segments are delivered in order,
+ * so a retransmitted segment holds up the ones behind it. A window update reaches the sender a latency after the read.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "esp_http_server.h"
+#include "esp_timer.h"
+#include "idf_shim.h"
+#include "sys/param.h"
+
+// Segments on their way or waiting in the socket at most, the sender waits while this many are unread
+#define IDF_SHIM_SOCKET_SEGMENTS	64
+
+// File descriptor of every connection
+#define IDF_SHIM_SOCKFD				54
+
+/**
+ * Segment sent by the socket stand-in
+ */
+typedef struct idf_shim_inflight
+{
+	int64_t arrival;			///> Time the segment can be read
+	size_t end;					///> Offset in the body the segment ends at
+} idf_shim_inflight_t;
+
+/**
+ * Connection of a request run by idf_shim_httpd_run, shared by the copies of the request
+ */
+typedef struct idf_shim_session
+{
+	idf_shim_request_t *request;
+
+	// Socket stand-in
+	size_t sent;				///> Body bytes sent
+	size_t read;				///> Body bytes read by the handler
+	size_t trace_pos;			///> Next segment of the trace
+	int64_t last_send;			///> Time the previous segment was sent
+	int64_t last_arrival;		///> Time the previous segment arrives
+	int64_t window_open;		///> Time the sender learns about room in the window
+	bool window_full;			///> The sender waits for the window
+	idf_shim_inflight_t inflight[IDF_SHIM_SOCKET_SEGMENTS];
+	size_t inflight_head;
+	size_t inflight_count;
+
+	// Set once the request is answered and released
+	pthread_mutex_t lock;
+	pthread_cond_t done_cond;
+	bool async;
+	bool done;
+} idf_shim_session_t;
+
+/**
+ * Running server
+ */
+typedef struct idf_shim_server
+{
+	httpd_config_t config;
+	httpd_uri_t *handlers;
+	size_t handler_count;
+} idf_shim_server_t;
+
+static idf_shim_server_t idf_shim_server;
+static bool idf_shim_server_running = false;
+
+// Connection of the request idf_shim_httpd_run is running
+static idf_shim_session_t *idf_shim_active_session = NULL;
+
+/**
+ * Sends every segment the sender can send by now. The sender is ahead of the receiver by the segments in flight,
+ * so a segment may arrive in the future.
+ * @param session connection.
+ */
+static void idf_shim_socket_send(idf_shim_session_t *session)
+{
+	const idf_shim_socket_t *socket = session->request->socket;
+
+	while (session->sent < session->request->body_len && session->inflight_count < IDF_SHIM_SOCKET_SEGMENTS)
+	{
+		const idf_shim_segment_t *segment = &socket->trace[session->trace_pos];
+		size_t len = MIN(segment->len, session->request->body_len - session->sent);
+
+		if (session->sent - session->read + len > socket->window)
+		{
+			session->window_full = true;
+			break;
+		}
+
+		int64_t send_time = MAX(session->last_send + segment->gap_us, session->window_open);
+		int64_t arrival = MAX(send_time + socket->latency_us + segment->delay_us, session->last_arrival);
+
+		session->sent += len;
+		session->last_send = send_time;
+		session->last_arrival = arrival;
+		session->inflight[(session->inflight_head + session->inflight_count) % IDF_SHIM_SOCKET_SEGMENTS] = (idf_shim_inflight_t) {
+				.arrival = arrival,
+				.end = session->sent,
+		};
+		session->inflight_count++;
+		session->trace_pos = (session->trace_pos + 1) % socket->trace_len;
+	}
+}
+
+/**
+ * Gets the end of the body bytes which have arrived.
+ * @param session connection.
+ * @param now current time.
+ * @return offset in the body.
+ */
+static size_t idf_shim_socket_arrived(const idf_shim_session_t *session, int64_t now)
+{
+	size_t end = session->read;
+
+	for (size_t i = 0; i < session->inflight_count; i++)
+	{
+		const idf_shim_inflight_t *segment = &session->inflight[(session->inflight_head + i) % IDF_SHIM_SOCKET_SEGMENTS];
+
+		if (segment->arrival > now)
+		{
+			break;
+		}
+		end = segment->end;
+	}
+
+	return end;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+	idf_shim_session_t *session = r->aux;
+	idf_shim_request_t *request = session->request;
+	int64_t deadline = esp_timer_get_time() + (int64_t)idf_shim_server.config.recv_wait_timeout * 1000000;
+
+	if (session->read == request->body_len)
+	{
+		return 0;
+	}
+
+	for (;;)
+	{
+		int64_t now = esp_timer_get_time();
+		size_t arrived;
+
+		idf_shim_socket_send(session);
+		arrived = idf_shim_socket_arrived(session, now);
+		if (arrived > session->read)
+		{
+			size_t len = MIN(buf_len, arrived - session->read);
+
+			memcpy(buf, &request->body[session->read], len);
+			session->read += len;
+
+			// Segments read completely leave the socket
+			while (session->inflight_count > 0 && session->inflight[session->inflight_head].end <= session->read)
+			{
+				if (request->latency_count < request->latency_cap)
+				{
+					request->latency_us[request->latency_count++] = now - session->inflight[session->inflight_head].arrival;
+				}
+				session->inflight_head = (session->inflight_head + 1) % IDF_SHIM_SOCKET_SEGMENTS;
+				session->inflight_count--;
+			}
+
+			// The window update reaches the sender a latency later
+			if (session->window_full)
+			{
+				session->window_full = false;
+				session->window_open = now + request->socket->latency_us;
+			}
+
+			return len;
+		}
+
+		if (now >= deadline)
+		{
+			return HTTPD_SOCK_ERR_TIMEOUT;
+		}
+		idf_shim_sleep_until(MIN(session->inflight[session->inflight_head].arrival, deadline));
+	}
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+	(void)r;
+
+	return IDF_SHIM_SOCKFD;
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+	if (idf_shim_server_running)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	idf_shim_server.config = *config;
+	idf_shim_server.handlers = calloc(config->max_uri_handlers, sizeof(httpd_uri_t));
+	idf_shim_server.handler_count = 0;
+	if (idf_shim_server.handlers == NULL)
+	{
+		return ESP_ERR_HTTPD_ALLOC_MEM;
+	}
+	idf_shim_server_running = true;
+	*handle = &idf_shim_server;
+
+	return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+	(void)handle;
+
+	free(idf_shim_server.handlers);
+	idf_shim_server.handlers = NULL;
+	idf_shim_server_running = false;
+
+	return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+	(void)handle;
+
+	if (idf_shim_server.handler_count == idf_shim_server.config.max_uri_handlers)
+	{
+		return ESP_ERR_HTTPD_HANDLERS_FULL;
+	}
+	idf_shim_server.handlers[idf_shim_server.handler_count++] = *uri_handler;
+
+	return ESP_OK;
+}
+
+bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match, size_t match_upto)
+{
+	size_t len = strlen(uri_template);
+
+	if (len > 0 && uri_template[len - 1] == '*')
+	{
+		return match_upto >= len - 1 && strncmp(uri_template, uri_to_match, len - 1) == 0;
+	}
+
+	return match_upto == len && strncmp(uri_template, uri_to_match, len) == 0;
+}
+
+esp_err_t idf_shim_httpd_run(idf_shim_request_t *request)
+{
+	idf_shim_session_t session = {
+			.request = request,
+	};
+	httpd_req_t req = {
+			.handle = &idf_shim_server,
+			.method = request->method,
+			.content_len = request->body_len,
+			.aux = &session,
+	};
+	const httpd_uri_t *handler = NULL;
+	size_t match_upto = strcspn(request->uri, "?");
+
+	if (!idf_shim_server_running)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	// First match in the order of registration, as the server does
+	for (size_t i = 0; i < idf_shim_server.handler_count && handler == NULL; i++)
+	{
+		const httpd_uri_t *candidate = &idf_shim_server.handlers[i];
+
+		if (candidate->method == request->method &&
+			((idf_shim_server.config.uri_match_fn != NULL) ? idf_shim_server.config.uri_match_fn(candidate->uri, request->uri, match_upto) :
+					(strlen(candidate->uri) == match_upto && strncmp(candidate->uri, request->uri, match_upto) == 0)))
+		{
+			handler = candidate;
+		}
+	}
+	if (handler == NULL)
+	{
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	strncpy((char *)req.uri, request->uri, HTTPD_MAX_URI_LEN);
+	req.user_ctx = handler->user_ctx;
+	strcpy(request->status, HTTPD_200);
+	request->response[0] = '\0';
+	request->closed = false;
+	request->latency_count = 0;
+	session.last_send = esp_timer_get_time();
+	pthread_mutex_init(&session.lock, NULL);
+	pthread_cond_init(&session.done_cond, NULL);
+	idf_shim_active_session = &session;
+
+	// A handler which fails has its connection closed
+	if (handler->handler(&req) != ESP_OK)
+	{
+		request->closed = true;
+	}
+
+	pthread_mutex_lock(&session.lock);
+	if (!session.async)
+	{
+		session.done = true;
+	}
+	while (!session.done)
+	{
+		pthread_cond_wait(&session.done_cond, &session.lock);
+	}
+	pthread_mutex_unlock(&session.lock);
+
+	idf_shim_active_session = NULL;
+	pthread_mutex_destroy(&session.lock);
+	pthread_cond_destroy(&session.done_cond);
+
+	return ESP_OK;
+}
+
+/**
+ * Finds a name and value pair of the request.
+ * @param pairs name and value pairs, the unused ones NULL.
+ * @param name name to look for, compared case-insensitively.
+ * @return value, NULL if the name is not there.
+ */
+static const char *idf_shim_find_header(const char *const pairs[][2], const char *name)
+{
+	for (size_t i = 0; i < IDF_SHIM_MAX_HEADERS && pairs[i][0] != NULL; i++)
+	{
+		if (strcasecmp(pairs[i][0], name) == 0)
+		{
+			return pairs[i][1];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Copies a value into a caller's buffer the way the server does.
+ * @return ESP_OK, ESP_ERR_HTTPD_RESULT_TRUNC if the value was cut short to fit.
+ */
+static esp_err_t idf_shim_copy_value(const char *value, size_t len, char *buf, size_t buf_len)
+{
+	if (buf == NULL || buf_len == 0)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	size_t copy_len = MIN(len, buf_len - 1);
+	memcpy(buf, value, copy_len);
+	buf[copy_len] = '\0';
+
+	return (copy_len < len) ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size)
+{
+	idf_shim_session_t *session = r->aux;
+	const char *value = idf_shim_find_header(session->request->headers, field);
+
+	if (value == NULL)
+	{
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	return idf_shim_copy_value(value, strlen(value), val, val_size);
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len)
+{
+	const char *query = strchr(r->uri, '?');
+
+	if (query == NULL)
+	{
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	return idf_shim_copy_value(query + 1, strlen(query + 1), buf, buf_len);
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size)
+{
+	size_t key_len = strlen(key);
+	const char *pos = qry;
+
+	while (*pos != '\0')
+	{
+		size_t len = strcspn(pos, "&");
+
+		if (len > key_len && strncmp(pos, key, key_len) == 0 && pos[key_len] == '=')
+		{
+			return idf_shim_copy_value(&pos[key_len + 1], len - key_len - 1, val, val_size);
+		}
+		pos += len + (pos[len] == '&');
+	}
+
+	return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+	idf_shim_session_t *session = r->aux;
+	size_t len = (buf == NULL) ? 0 : (buf_len == HTTPD_RESP_USE_STRLEN) ? strlen(buf) : (size_t)buf_len;
+
+	idf_shim_copy_value((buf != NULL) ? buf : "", len, session->request->response, sizeof(session->request->response));
+
+	return ESP_OK;
+}
+
+esp_err_t httpd_resp_sendstr(httpd_req_t *r, const char *str)
+{
+	return httpd_resp_send(r, str, (str == NULL) ? 0 : HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+	idf_shim_session_t *session = r->aux;
+
+	idf_shim_copy_value(status, strlen(status), session->request->status, sizeof(session->request->status));
+
+	return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+	(void)r;
+	(void)type;
+
+	return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+	idf_shim_session_t *session = r->aux;
+
+	if (strcasecmp(field, "Connection") == 0 && strcasecmp(value, "close") == 0)
+	{
+		session->request->closed = true;
+	}
+
+	return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+	static const char *const statuses[HTTPD_ERR_CODE_MAX] = {
+			[HTTPD_500_INTERNAL_SERVER_ERROR] = "500 Internal Server Error",
+			[HTTPD_501_METHOD_NOT_IMPLEMENTED] = "501 Method Not Implemented",
+			[HTTPD_505_VERSION_NOT_SUPPORTED] = "505 Version Not Supported",
+			[HTTPD_400_BAD_REQUEST] = "400 Bad Request",
+			[HTTPD_401_UNAUTHORIZED] = "401 Unauthorized",
+			[HTTPD_403_FORBIDDEN] = "403 Forbidden",
+			[HTTPD_404_NOT_FOUND] = "404 Not Found",
+			[HTTPD_405_METHOD_NOT_ALLOWED] = "405 Method Not Allowed",
+			[HTTPD_408_REQ_TIMEOUT] = "408 Request Timeout",
+			[HTTPD_411_LENGTH_REQUIRED] = "411 Length Required",
+			[HTTPD_414_URI_TOO_LONG] = "414 URI Too Long",
+			[HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE] = "431 Request Header Fields Too Large",
+	};
+	const char *status = (error < HTTPD_ERR_CODE_MAX) ? statuses[error] : statuses[HTTPD_500_INTERNAL_SERVER_ERROR];
+
+	httpd_resp_set_status(req, status);
+
+	return httpd_resp_sendstr(req, (msg != NULL) ? msg : status);
+}
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out)
+{
+	idf_shim_session_t *session = r->aux;
+	httpd_req_t *copy = malloc(sizeof(*copy));
+
+	if (copy == NULL)
+	{
+		return ESP_ERR_NO_MEM;
+	}
+	memcpy(copy, r, sizeof(*copy));
+
+	pthread_mutex_lock(&session->lock);
+	session->async = true;
+	pthread_mutex_unlock(&session->lock);
+	*out = copy;
+
+	return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r)
+{
+	idf_shim_session_t *session = r->aux;
+
+	free(r);
+
+	pthread_mutex_lock(&session->lock);
+	session->done = true;
+	pthread_cond_signal(&session->done_cond);
+	pthread_mutex_unlock(&session->lock);
+
+	return ESP_OK;
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg)
+{
+	(void)handle;
+
+	work(arg);
+
+	return ESP_OK;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+	(void)handle;
+
+	// Every connection has the same descriptor, it belongs to the request which is running
+	if (sockfd != IDF_SHIM_SOCKFD || idf_shim_active_session == NULL)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	idf_shim_active_session->request->closed = true;
+
+	return ESP_OK;
+}
+
+esp_err_t httpd_get_client_list(httpd_handle_t handle, size_t *fds, int *client_fds)
+{
+	(void)handle;
+	(void)client_fds;
+
+	*fds = 0;
+
+	return ESP_OK;
+}
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len)
+{
+	(void)req;
+	(void)pkt;
+	(void)max_len;
+
+	return ESP_FAIL;
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+	(void)hd;
+	(void)fd;
+	(void)frame;
+
+	return ESP_FAIL;
+}
+
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd)
+{
+	(void)hd;
+	(void)fd;
+
+	return HTTPD_WS_CLIENT_INVALID;
+}
@@ -0,0 +1,313 @@
+/*
+ * idf_shim_system.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Time, logging, error names, timers, SHA-256 and heap accounting of the host stand-ins.
+ * The heap is accounted by wrapping malloc and friends, the executable is linked with
+ * -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free,--wrap=strdup
+ */
+
+#include <malloc.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_image_format.h"
+#include "esp_ota_ops.h"
+#include "esp_timer.h"
+#include "idf_shim.h"
+#include "mbedtls/sha256.h"
+#include "nvs.h"
+
+// Scale of the emulated delays
+static double idf_shim_time_scale = 1.0;
+
+// Most detailed log level printed
+static esp_log_level_t idf_shim_log_level = ESP_LOG_WARN;
+
+// Heap in use and its peak since idf_shim_heap_reset_peak
+static atomic_long idf_shim_heap_used = 0;
+static atomic_long idf_shim_heap_high = 0;
+static atomic_long idf_shim_heap_base = 0;
+
+// Timer handed out by esp_timer_create, it never fires
+static struct esp_timer
+{
+	esp_timer_cb_t callback;
+} idf_shim_timer;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+/**
+ * Reads the monotonic clock.
+ * @return time in microseconds.
+ */
+static int64_t idf_shim_clock_us(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+int64_t esp_timer_get_time(void)
+{
+	static int64_t boot = 0;
+
+	if (boot == 0)
+	{
+		boot = idf_shim_clock_us() - 1;
+	}
+
+	return idf_shim_clock_us() - boot;
+}
+
+void idf_shim_set_time_scale(double scale)
+{
+	idf_shim_time_scale = scale;
+}
+
+void idf_shim_sleep_until(int64_t at)
+{
+	int64_t now = esp_timer_get_time();
+
+	if (at > now)
+	{
+		struct timespec delay = {
+				.tv_sec = (at - now) / 1000000,
+				.tv_nsec = (at - now) % 1000000 * 1000,
+		};
+		nanosleep(&delay, NULL);
+	}
+}
+
+void idf_shim_delay_us(uint64_t us)
+{
+	idf_shim_sleep_until(esp_timer_get_time() + (int64_t)(us * idf_shim_time_scale));
+}
+
+void idf_shim_set_log_level(esp_log_level_t level)
+{
+	idf_shim_log_level = level;
+}
+
+void idf_shim_log(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+	static const char letters[] = "NEWIDV";
+	va_list args;
+
+	if (level > idf_shim_log_level)
+	{
+		return;
+	}
+
+	fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(esp_timer_get_time() / 1000), tag);
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+	static const struct
+	{
+		esp_err_t code;
+		const char *name;
+	} names[] = {
+			{ ESP_OK, "ESP_OK" },
+			{ ESP_FAIL, "ESP_FAIL" },
+			{ ESP_ERR_NO_MEM, "ESP_ERR_NO_MEM" },
+			{ ESP_ERR_INVALID_ARG, "ESP_ERR_INVALID_ARG" },
+			{ ESP_ERR_INVALID_STATE, "ESP_ERR_INVALID_STATE" },
+			{ ESP_ERR_INVALID_SIZE, "ESP_ERR_INVALID_SIZE" },
+			{ ESP_ERR_NOT_FOUND, "ESP_ERR_NOT_FOUND" },
+			{ ESP_ERR_NOT_SUPPORTED, "ESP_ERR_NOT_SUPPORTED" },
+			{ ESP_ERR_TIMEOUT, "ESP_ERR_TIMEOUT" },
+			{ ESP_ERR_INVALID_CRC, "ESP_ERR_INVALID_CRC" },
+			{ ESP_ERR_INVALID_VERSION, "ESP_ERR_INVALID_VERSION" },
+			{ ESP_ERR_IMAGE_INVALID, "ESP_ERR_IMAGE_INVALID" },
+			{ ESP_ERR_OTA_VALIDATE_FAILED, "ESP_ERR_OTA_VALIDATE_FAILED" },
+			{ ESP_ERR_NVS_NOT_FOUND, "ESP_ERR_NVS_NOT_FOUND" },
+			{ ESP_ERR_HTTPD_RESULT_TRUNC, "ESP_ERR_HTTPD_RESULT_TRUNC" },
+	};
+
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+	{
+		if (names[i].code == code)
+		{
+			return names[i].name;
+		}
+	}
+
+	return "UNKNOWN ERROR";
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+	idf_shim_timer.callback = create_args->callback;
+	*out_handle = &idf_shim_timer;
+
+	return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+	(void)timer;
+	(void)timeout_us;
+
+	return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+	(void)timer;
+
+	return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+	(void)timer;
+
+	return ESP_OK;
+}
+
+void esp_restart(void)
+{
+	fprintf(stderr, "esp_restart called\n");
+	abort();
+}
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx)
+{
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx)
+{
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha256_clone(mbedtls_sha256_context *dst, const mbedtls_sha256_context *src)
+{
+	*dst = *src;
+}
+
+int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224)
+{
+	if (is224)
+	{
+		return -1;
+	}
+	fixture_sha256_init(&ctx->sha);
+
+	return 0;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen)
+{
+	fixture_sha256_update(&ctx->sha, input, ilen);
+
+	return 0;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char *output)
+{
+	fixture_sha256_finish(&ctx->sha, output);
+
+	return 0;
+}
+
+void idf_shim_heap_track(long bytes)
+{
+	long used = atomic_fetch_add(&idf_shim_heap_used, bytes) + bytes;
+	long high = atomic_load(&idf_shim_heap_high);
+
+	while (used > high && !atomic_compare_exchange_weak(&idf_shim_heap_high, &high, used))
+	{
+	}
+}
+
+void idf_shim_heap_reset_peak(void)
+{
+	long used = atomic_load(&idf_shim_heap_used);
+
+	atomic_store(&idf_shim_heap_base, used);
+	atomic_store(&idf_shim_heap_high, used);
+}
+
+size_t idf_shim_heap_peak(void)
+{
+	return atomic_load(&idf_shim_heap_high) - atomic_load(&idf_shim_heap_base);
+}
+
+void *__wrap_malloc(size_t size)
+{
+	void *ptr = __real_malloc(size);
+
+	if (ptr != NULL)
+	{
+		idf_shim_heap_track(malloc_usable_size(ptr));
+	}
+
+	return ptr;
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	void *ptr = __real_calloc(nmemb, size);
+
+	if (ptr != NULL)
+	{
+		idf_shim_heap_track(malloc_usable_size(ptr));
+	}
+
+	return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	size_t old_size = (ptr != NULL) ? malloc_usable_size(ptr) : 0;
+	void *new_ptr = __real_realloc(ptr, size);
+
+	if (new_ptr != NULL)
+	{
+		idf_shim_heap_track((long)malloc_usable_size(new_ptr) - (long)old_size);
+	}
+	else if (size == 0)
+	{
+		idf_shim_heap_track(-(long)old_size);
+	}
+
+	return new_ptr;
+}
+
+void __wrap_free(void *ptr)
+{
+	if (ptr != NULL)
+	{
+		idf_shim_heap_track(-(long)malloc_usable_size(ptr));
+	}
+	__real_free(ptr);
+}
+
+char *__wrap_strdup(const char *s)
+{
+	size_t len = strlen(s) + 1;
+	char *copy = __wrap_malloc(len);
+
+	if (copy != NULL)
+	{
+		memcpy(copy, s, len);
+	}
+
+	return copy;
+}
@@ -0,0 +1,32 @@
+/*
+ * sha256.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the mbedtls header of the same name, hashing with the reference SHA-256 of the fixtures.
+ */
+
+#ifndef TEST_IDF_SHIM_MBEDTLS_SHA256_H_
+#define TEST_IDF_SHIM_MBEDTLS_SHA256_H_
+
+#include <stddef.h>
+
+#include "fixtures.h"
+
+typedef struct mbedtls_sha256_context
+{
+	fixture_sha256_t sha;
+} mbedtls_sha256_context;
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx);
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx);
+void mbedtls_sha256_clone(mbedtls_sha256_context *dst, const mbedtls_sha256_context *src);
+
+/**
+ * Starts a SHA-256 computation, SHA-224 is not supported.
+ */
+int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224);
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen);
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char *output);
+
+#endif /* TEST_IDF_SHIM_MBEDTLS_SHA256_H_ */
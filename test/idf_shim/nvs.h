@@ -0,0 +1,38 @@
+/*
+ * nvs.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host stand-in for the ESP-IDF header of the same name, the entries are kept in memory.
+ */
+
+#ifndef TEST_IDF_SHIM_NVS_H_
+#define TEST_IDF_SHIM_NVS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define ESP_ERR_NVS_BASE				0x1100
+#define ESP_ERR_NVS_NOT_FOUND			(ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_INVALID_HANDLE		(ESP_ERR_NVS_BASE + 0x07)
+#define ESP_ERR_NVS_INVALID_LENGTH		(ESP_ERR_NVS_BASE + 0x0c)
+#define ESP_ERR_NVS_NOT_ENOUGH_SPACE	(ESP_ERR_NVS_BASE + 0x05)
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum
+{
+	NVS_READONLY,
+	NVS_READWRITE,
+} nvs_open_mode_t;
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle);
+void nvs_close(nvs_handle_t handle);
+esp_err_t nvs_commit(nvs_handle_t handle);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length);
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length);
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key);
+
+#endif /* TEST_IDF_SHIM_NVS_H_ */
@@ -0,0 +1,18 @@
+/*
+ * sdkconfig.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Configuration of the emulated device, the values of the ESP32-S3 build the firmware sources read.
+ */
+
+#ifndef TEST_IDF_SHIM_SDKCONFIG_H_
+#define TEST_IDF_SHIM_SDKCONFIG_H_
+
+#define CONFIG_IDF_FIRMWARE_CHIP_ID			0x0009		// ESP32-S3
+#define CONFIG_FREERTOS_HZ					100
+#define CONFIG_LWIP_MAX_SOCKETS				10
+#define CONFIG_LWIP_TCP_MSS					1440
+#define CONFIG_LWIP_TCP_WND_DEFAULT			5760
+
+#endif /* TEST_IDF_SHIM_SDKCONFIG_H_ */
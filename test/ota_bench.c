@@ -0,0 +1,333 @@
+/*
+ * ota_bench.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host benchmark of the OTA stream stages: multipart parsing, heatshrink decompression and bsdiff patching.
+ * Every stage is fed a firmware-like image in chunks of the sizes httpd_req_recv typically returns,
+ * the output is checked against the image so a broken stage cannot report a good number.
+ * The receive paths of POST /OTAupdate and PUT /firmware are compared as well: both collect the image
+ * into flash sectors, the first through a receive buffer and the multipart parser, the second straight.
+ *
+ * Usage: ota_bench [image size in KB]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bspatch.h"
+#include "fixtures.h"
+#include "heatshrink_decoder.h"
+#include "multipart_parser.h"
+#include "sys/param.h"
+
+// Benchmark settings
+#define OTA_BENCH_DEFAULT_KB		1024		// Size of a typical image
+#define OTA_BENCH_MIN_NS			200000000	// Each measurement repeats until it ran this long
+#define OTA_BENCH_RECV_BUFFER_SIZE	1024		// Receive buffer of http_server_OTA_update_handler
+#define OTA_BENCH_SECTOR_SIZE		4096		// Buffers of the OTA writer hold one flash sector
+
+// Chunk sizes fed to the stages: small reads, one TCP segment, the OTA writer buffer and a flash sector
+static const size_t ota_bench_chunk_sizes[] = { 64, 256, 1436, 4096, 16384 };
+
+#define OTA_BENCH_CHUNK_SIZE_COUNT	(sizeof(ota_bench_chunk_sizes) / sizeof(ota_bench_chunk_sizes[0]))
+
+/**
+ * Output checked against the expected image
+ */
+typedef struct ota_bench_sink
+{
+	const uint8_t *expected;
+	size_t len;
+	size_t pos;
+	int mismatch;
+} ota_bench_sink_t;
+
+/**
+ * Stage under test, runs the whole stream once in chunks
+ */
+typedef int (*ota_bench_stage_t)(const uint8_t *data, size_t len, size_t chunk, ota_bench_sink_t *sink);
+
+// Old image the bsdiff stage reads from
+static const uint8_t *ota_bench_old_image;
+
+// Sector buffer standing in for the buffers of the OTA writer
+static uint8_t ota_bench_sector[OTA_BENCH_SECTOR_SIZE];
+static size_t ota_bench_sector_fill;
+
+/**
+ * Output callback of every stage, compares the output with the expected image.
+ */
+static int ota_bench_output(void *ctx, const uint8_t *data, size_t len)
+{
+	ota_bench_sink_t *sink = ctx;
+
+	if (sink->pos + len > sink->len || memcmp(&sink->expected[sink->pos], data, len) != 0)
+	{
+		sink->mismatch = 1;
+		return -1;
+	}
+	sink->pos += len;
+
+	return 0;
+}
+
+/**
+ * Commits bytes stored in the sector buffer, a full sector is programmed by handing it to the sink.
+ * @return 0 on success, -1 if the output is wrong.
+ */
+static int ota_bench_sector_commit(ota_bench_sink_t *sink, size_t len)
+{
+	ota_bench_sector_fill += len;
+	if (ota_bench_sector_fill == OTA_BENCH_SECTOR_SIZE || sink->pos + ota_bench_sector_fill == sink->len)
+	{
+		int ret = ota_bench_output(sink, ota_bench_sector, ota_bench_sector_fill);
+		ota_bench_sector_fill = 0;
+		return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * Multipart parser callback, copies the image bytes into the sector buffer like ota_writer_write.
+ */
+static int ota_bench_sector_write(void *ctx, const uint8_t *data, size_t len)
+{
+	while (len > 0)
+	{
+		size_t chunk = MIN(len, OTA_BENCH_SECTOR_SIZE - ota_bench_sector_fill);
+
+		memcpy(&ota_bench_sector[ota_bench_sector_fill], data, chunk);
+		if (ota_bench_sector_commit(ctx, chunk) != 0)
+		{
+			return -1;
+		}
+		data += chunk;
+		len -= chunk;
+	}
+
+	return 0;
+}
+
+/**
+ * Read callback of the bsdiff stage.
+ */
+static int ota_bench_read_old(void *ctx, size_t offset, uint8_t *buf, size_t len)
+{
+	(void)ctx;
+	memcpy(buf, &ota_bench_old_image[offset], len);
+
+	return 0;
+}
+
+static int ota_bench_multipart(const uint8_t *data, size_t len, size_t chunk, ota_bench_sink_t *sink)
+{
+	multipart_parser_t parser;
+	multipart_parser_result_e result = MULTIPART_PARSER_OK;
+
+	if (multipart_parser_init(&parser, "multipart/form-data; boundary=" FIXTURE_BOUNDARY, ota_bench_output, sink) != 0)
+	{
+		return -1;
+	}
+	for (size_t pos = 0; pos < len && result == MULTIPART_PARSER_OK; pos += chunk)
+	{
+		result = multipart_parser_feed(&parser, &data[pos], MIN(len - pos, chunk));
+	}
+
+	return (result == MULTIPART_PARSER_DONE) ? 0 : -1;
+}
+
+/**
+ * Receive path of POST /OTAupdate: each read lands in the receive buffer, the parser copies the image bytes into sectors.
+ */
+static int ota_bench_form_upload(const uint8_t *data, size_t len, size_t chunk, ota_bench_sink_t *sink)
+{
+	uint8_t recv_buffer[OTA_BENCH_RECV_BUFFER_SIZE];
+	multipart_parser_t parser;
+	multipart_parser_result_e result = MULTIPART_PARSER_OK;
+
+	ota_bench_sector_fill = 0;
+	if (multipart_parser_init(&parser, "multipart/form-data; boundary=" FIXTURE_BOUNDARY, ota_bench_sector_write, sink) != 0)
+	{
+		return -1;
+	}
+	for (size_t pos = 0; pos < len && result == MULTIPART_PARSER_OK; )
+	{
+		size_t recv_len = MIN(MIN(len - pos, chunk), sizeof(recv_buffer));
+
+		memcpy(recv_buffer, &data[pos], recv_len);
+		result = multipart_parser_feed(&parser, recv_buffer, recv_len);
+		pos += recv_len;
+	}
+
+	return (result == MULTIPART_PARSER_DONE) ? 0 : -1;
+}
+
+/**
+ * Receive path of PUT /firmware: each read lands straight in the free space of the sector buffer.
+ */
+static int ota_bench_raw_upload(const uint8_t *data, size_t len, size_t chunk, ota_bench_sink_t *sink)
+{
+	ota_bench_sector_fill = 0;
+	for (size_t pos = 0; pos < len; )
+	{
+		size_t recv_len = MIN(MIN(len - pos, chunk), OTA_BENCH_SECTOR_SIZE - ota_bench_sector_fill);
+
+		memcpy(&ota_bench_sector[ota_bench_sector_fill], &data[pos], recv_len);
+		if (ota_bench_sector_commit(sink, recv_len) != 0)
+		{
+			return -1;
+		}
+		pos += recv_len;
+	}
+
+	return 0;
+}
+
+static int ota_bench_heatshrink(const uint8_t *data, size_t len, size_t chunk, ota_bench_sink_t *sink)
+{
+	static heatshrink_decoder_t decoder;
+
+	heatshrink_decoder_init(&decoder, ota_bench_output, sink);
+	for (size_t pos = 0; pos < len; pos += chunk)
+	{
+		if (heatshrink_decoder_feed(&decoder, &data[pos], MIN(len - pos, chunk)) != 0)
+		{
+			return -1;
+		}
+	}
+
+	return heatshrink_decoder_finish(&decoder);
+}
+
+static int ota_bench_bspatch(const uint8_t *data, size_t len, size_t chunk, ota_bench_sink_t *sink)
+{
+	static bspatch_t patch;
+
+	bspatch_init(&patch, sink->len, ota_bench_read_old, ota_bench_output, sink);
+	for (size_t pos = 0; pos < len; pos += chunk)
+	{
+		if (bspatch_feed(&patch, &data[pos], MIN(len - pos, chunk)) != 0)
+		{
+			return -1;
+		}
+	}
+
+	return bspatch_finish(&patch);
+}
+
+/**
+ * Monotonic time in nanoseconds.
+ */
+static int64_t ota_bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Runs a stage until OTA_BENCH_MIN_NS passed.
+ * @return throughput in MB/s of image output, negative if the stage failed or its output was wrong.
+ */
+static double ota_bench_run(ota_bench_stage_t stage, const uint8_t *data, size_t len, size_t chunk, const uint8_t *expected, size_t expected_len)
+{
+	int64_t start = ota_bench_now_ns();
+	int64_t elapsed;
+	unsigned runs = 0;
+
+	do
+	{
+		ota_bench_sink_t sink = { .expected = expected, .len = expected_len };
+
+		if (stage(data, len, chunk, &sink) != 0 || sink.mismatch || sink.pos != expected_len)
+		{
+			return -1;
+		}
+		runs++;
+		elapsed = ota_bench_now_ns() - start;
+	} while (elapsed < OTA_BENCH_MIN_NS);
+
+	return (double)expected_len * runs / (elapsed / 1e9) / (1024 * 1024);
+}
+
+int main(int argc, char **argv)
+{
+	size_t image_len = (size_t)((argc > 1) ? atoi(argv[1]) : OTA_BENCH_DEFAULT_KB) * 1024;
+	size_t insert_at = image_len / 3;
+	size_t insert_len = 512;
+	int failed = 0;
+
+	uint8_t *image = malloc(image_len);
+	uint8_t *old_image = malloc(image_len);
+	uint8_t *body = malloc(image_len + 512);
+	uint8_t *compressed = malloc(image_len + image_len / 8 + 16);
+	uint8_t *patch = malloc(image_len + 1024);
+	if (image_len < 4096 || !image || !old_image || !body || !compressed || !patch)
+	{
+		fprintf(stderr, "ota_bench: image size must be at least 4 KB\n");
+		return 1;
+	}
+
+	// The new image is the old one with a function inserted and a few constants changed
+	fixture_firmware(image, image_len, 1);
+	memcpy(old_image, image, insert_at);
+	memcpy(&old_image[insert_at], &image[insert_at + insert_len], image_len - insert_at - insert_len);
+	for (size_t i = 0; i < image_len - insert_len; i += 4099)
+	{
+		old_image[i] ^= 0x5A;
+	}
+	ota_bench_old_image = old_image;
+
+	size_t body_len = fixture_multipart(image, image_len, body, image_len + 512);
+	size_t compressed_len = fixture_heatshrink_encode(image, image_len, compressed, image_len + image_len / 8 + 16);
+	size_t patch_len = fixture_bspatch_create(old_image, image_len - insert_len, image, insert_at, insert_len, patch, image_len + 1024);
+
+	printf("Image %u bytes, heatshrink %u bytes (%.1f%% saved), bsdiff patch %u bytes\n", (unsigned)image_len, (unsigned)compressed_len,
+			100.0 * (image_len - compressed_len) / image_len, (unsigned)patch_len);
+	printf("Throughput in MB/s of image output\n");
+	printf("%8s %12s %12s %12s\n", "chunk", "multipart", "heatshrink", "bspatch");
+
+	for (size_t c = 0; c < OTA_BENCH_CHUNK_SIZE_COUNT; c++)
+	{
+		size_t chunk = ota_bench_chunk_sizes[c];
+		double multipart = ota_bench_run(ota_bench_multipart, body, body_len, chunk, image, image_len);
+		double heatshrink = ota_bench_run(ota_bench_heatshrink, compressed, compressed_len, chunk, image, image_len);
+		double bspatch = ota_bench_run(ota_bench_bspatch, patch, patch_len, chunk, image, image_len);
+
+		printf("%8u %12.1f %12.1f %12.1f\n", (unsigned)chunk, multipart, heatshrink, bspatch);
+		failed |= (multipart < 0 || heatshrink < 0 || bspatch < 0);
+	}
+
+	printf("\nReceive path into %u byte sectors, MB/s of image output\n", OTA_BENCH_SECTOR_SIZE);
+	printf("%8s %12s %12s\n", "chunk", "form", "raw");
+
+	for (size_t c = 0; c < OTA_BENCH_CHUNK_SIZE_COUNT; c++)
+	{
+		size_t chunk = ota_bench_chunk_sizes[c];
+		double form = ota_bench_run(ota_bench_form_upload, body, body_len, chunk, image, image_len);
+		double raw = ota_bench_run(ota_bench_raw_upload, image, image_len, chunk, image, image_len);
+
+		printf("%8u %12.1f %12.1f\n", (unsigned)chunk, form, raw);
+		failed |= (form < 0 || raw < 0);
+	}
+
+	free(image);
+	free(old_image);
+	free(body);
+	free(compressed);
+	free(patch);
+
+	if (failed)
+	{
+		fprintf(stderr, "ota_bench: a stage produced the wrong image\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,473 @@
+/*
+ * ota_pipeline_bench.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Host benchmark of the whole OTA receive and write path: the upload handlers of http_server.c and the pipeline of
+ * ota_writer.c run unchanged against the stand-ins of idf_shim, the body arrives from a socket replaying a trace
+ * and the image is programmed into the flash emulator. Every upload is checked: it has to be answered with 200,
+ * leave the image in the update partition and make it the boot partition.
+ * Reported per upload path, encoding and socket trace:
+ * - MB/s of image, from the request being dispatched until its connection is released,
+ * - p50 and p99 of the time a TCP segment waits in the socket until the handler has read it completely,
+ *   i.e. how long the pipeline keeps the receive window closed,
+ * - the time the flash chip was busy, and the peak heap above the idle server, task stacks included.
+ * The buffer size and count of the OTA writer size its pool at compile time, every combination is an executable
+ * of its own: ota_pipeline_bench_<size>x<count>, the ota_pipeline_sweep target runs them all.
+ * The pre-erase task is not started, so every upload erases as it goes.
+ *
+ * Usage: ota_pipeline_bench_<size>x<count> [-k image size in KB] [-s time scale] [-t trace file [-l latency in us]] [-v]
+ * A trace file has a line "<gap us> <bytes> [<extra delay us>]" per TCP segment, see idf_shim_segment_t.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "esp_ota_ops.h"
+#include "esp_timer.h"
+#include "fixtures.h"
+#include "freertos/FreeRTOS.h"
+#include "http_server.h"
+#include "idf_shim.h"
+#include "ota_digest.h"
+#include "ota_writer.h"
+#include "sensor_manager.h"
+#include "sys/param.h"
+#include "webpage_assets.h"
+
+// Benchmark settings
+#define OTA_PIPELINE_BENCH_DEFAULT_KB		1024		// Size of a typical image
+#define OTA_PIPELINE_BENCH_SEGMENT			1440		// TCP_MSS of the device
+#define OTA_PIPELINE_BENCH_INSERT_LEN		512			// Bytes a delta update inserts into the running image
+#define OTA_PIPELINE_BENCH_SEGMENTS			4			// Segments of the generated images
+#define OTA_PIPELINE_BENCH_TRACE_MAX		4096		// Segments of a trace file
+#define OTA_PIPELINE_BENCH_UPDATE_VERSION	"2.0.0"
+
+// Typical timings of the W25Q32JV flash on ESP32-S3 modules, reads through the flash driver at about 20 MB/s
+static const idf_shim_flash_timing_t ota_pipeline_bench_flash = {
+		.sector_erase_us = 45000,
+		.block_erase_us = 150000,
+		.page_program_us = 400,
+		.read_kb_us = 50,
+};
+
+/**
+ * Socket trace generated from the properties of a link
+ */
+typedef struct ota_pipeline_bench_link
+{
+	const char *name;
+	uint32_t bytes_per_s;				///> Link rate
+	uint32_t latency_us;				///> One-way latency
+	uint32_t loss_per_mille;			///> Segments lost
+	uint32_t retransmit_us;				///> Extra delay of a lost segment until it is sent again
+} ota_pipeline_bench_link_t;
+
+static const ota_pipeline_bench_link_t ota_pipeline_bench_links[] = {
+		{ "fast", 2500000, 2000, 0, 0 },
+		{ "wifi", 1000000, 5000, 0, 0 },
+		{ "lossy", 1000000, 20000, 10, 250000 },
+};
+
+// Scale of the emulated delays, the measurements are reported in the time of the device
+static double ota_pipeline_bench_scale = 1.0;
+
+#define OTA_PIPELINE_BENCH_LINK_COUNT	(sizeof(ota_pipeline_bench_links) / sizeof(ota_pipeline_bench_links[0]))
+
+/**
+ * Upload encodings
+ */
+typedef enum ota_pipeline_bench_encoding
+{
+	OTA_PIPELINE_BENCH_PLAIN = 0,
+	OTA_PIPELINE_BENCH_HEATSHRINK,
+	OTA_PIPELINE_BENCH_DELTA,
+	OTA_PIPELINE_BENCH_ENCODING_COUNT,
+} ota_pipeline_bench_encoding_e;
+
+static const char *const ota_pipeline_bench_encoding_names[] = { "plain", "heatshrink", "delta" };
+static const char *const ota_pipeline_bench_encoding_queries[] = { "", "?encoding=heatshrink", "?delta=1" };
+
+/**
+ * Outcome of an upload
+ */
+typedef struct ota_pipeline_bench_result
+{
+	bool ok;
+	double seconds;
+	double p50_ms;
+	double p99_ms;
+	double flash_ms;
+	size_t peak_heap;
+} ota_pipeline_bench_result_t;
+
+// Stand-ins for the modules of the firmware the benchmark does not build: no sensors and a single web page asset
+static const uint8_t ota_pipeline_bench_page[] = "<html></html>";
+
+const webpage_asset_t webpage_assets[] = {
+		{ "/index.html", "text/html", ota_pipeline_bench_page, sizeof(ota_pipeline_bench_page) - 1, "\"0\"",
+				ota_pipeline_bench_page, sizeof(ota_pipeline_bench_page) - 1, "\"0\"", "no-cache" },
+};
+const size_t webpage_asset_count = sizeof(webpage_assets) / sizeof(webpage_assets[0]);
+
+size_t sensor_manager_get_count(void)
+{
+	return 0;
+}
+
+esp_err_t sensor_manager_get_reading(size_t id, sensor_manager_reading_t *reading)
+{
+	(void)id;
+	memset(reading, 0, sizeof(*reading));
+
+	return ESP_ERR_NOT_FOUND;
+}
+
+uint32_t sensor_manager_get_sequence(void)
+{
+	return 0;
+}
+
+uint32_t sensor_manager_wait_for_sequence(uint32_t after, uint32_t timeout_ms)
+{
+	(void)after;
+	(void)timeout_ms;
+
+	return 0;
+}
+
+/**
+ * Turns firmware-like data into an application image of the emulated chip: an image header,
+ * OTA_PIPELINE_BENCH_SEGMENTS segments filling the rest and the application description in the first one.
+ * @param image data to stamp the headers onto.
+ * @param len size of image.
+ * @param version application version.
+ */
+static void ota_pipeline_bench_stamp(uint8_t *image, size_t len, const char *version)
+{
+	esp_image_header_t header = {
+			.magic = ESP_IMAGE_HEADER_MAGIC,
+			.segment_count = OTA_PIPELINE_BENCH_SEGMENTS,
+			.chip_id = CONFIG_IDF_FIRMWARE_CHIP_ID,
+	};
+	esp_app_desc_t app_desc = {
+			.magic_word = ESP_APP_DESC_MAGIC_WORD,
+			.project_name = "OTA_UPDATE",
+	};
+	size_t data_len = (len - sizeof(header) - OTA_PIPELINE_BENCH_SEGMENTS * sizeof(esp_image_segment_header_t)) / OTA_PIPELINE_BENCH_SEGMENTS;
+	size_t pos = sizeof(header);
+
+	strncpy(app_desc.version, version, sizeof(app_desc.version) - 1);
+	memcpy(image, &header, sizeof(header));
+
+	for (int i = 0; i < OTA_PIPELINE_BENCH_SEGMENTS; i++)
+	{
+		esp_image_segment_header_t segment = {
+				.load_addr = 0x3c000020 + i * 0x100000,
+				.data_len = (i < OTA_PIPELINE_BENCH_SEGMENTS - 1) ? data_len : len - pos - sizeof(segment),
+		};
+
+		memcpy(&image[pos], &segment, sizeof(segment));
+		if (i == 0)
+		{
+			memcpy(&image[pos + sizeof(segment)], &app_desc, sizeof(app_desc));
+		}
+		pos += sizeof(segment) + segment.data_len;
+	}
+}
+
+/**
+ * Generates the socket trace of a link.
+ * @param link properties of the link.
+ * @param trace set to the segments.
+ * @param count number of segments to generate.
+ */
+static void ota_pipeline_bench_link_trace(const ota_pipeline_bench_link_t *link, idf_shim_segment_t *trace, size_t count)
+{
+	uint32_t state = 12345;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		state = state * 1664525u + 1013904223u;
+		trace[i].gap_us = (uint64_t)OTA_PIPELINE_BENCH_SEGMENT * 1000000 / link->bytes_per_s;
+		trace[i].len = OTA_PIPELINE_BENCH_SEGMENT;
+		trace[i].delay_us = ((state >> 8) % 1000 < link->loss_per_mille) ? link->retransmit_us : 0;
+	}
+}
+
+/**
+ * Reads a socket trace from a file.
+ * @param path file with a line "<gap us> <bytes> [<extra delay us>]" per segment, # starts a comment.
+ * @param trace set to the segments.
+ * @param cap number of segments trace has room for.
+ * @return number of segments read, 0 if the file is unreadable or holds no segment.
+ */
+static size_t ota_pipeline_bench_read_trace(const char *path, idf_shim_segment_t *trace, size_t cap)
+{
+	FILE *file = fopen(path, "r");
+	char line[128];
+	size_t count = 0;
+
+	if (file == NULL)
+	{
+		return 0;
+	}
+
+	while (count < cap && fgets(line, sizeof(line), file) != NULL)
+	{
+		unsigned gap, len, delay = 0;
+
+		if (line[0] != '#' && sscanf(line, "%u %u %u", &gap, &len, &delay) >= 2 && len > 0)
+		{
+			trace[count++] = (idf_shim_segment_t) { .gap_us = gap, .len = len, .delay_us = delay };
+		}
+	}
+	fclose(file);
+
+	return count;
+}
+
+/**
+ * Compares two latencies, for qsort.
+ */
+static int ota_pipeline_bench_compare(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * Gets a percentile of the segment latencies, sorting them.
+ * @return latency in milliseconds.
+ */
+static double ota_pipeline_bench_percentile(uint32_t *latency_us, size_t count, unsigned percent)
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+	qsort(latency_us, count, sizeof(latency_us[0]), ota_pipeline_bench_compare);
+
+	return latency_us[(count - 1) * percent / 100] / ota_pipeline_bench_scale / 1000.0;
+}
+
+/**
+ * Runs one upload through the firmware and checks its outcome.
+ * @param request upload, its latency buffer allocated already.
+ * @param image image the update partition has to hold afterwards.
+ * @param image_len size of image.
+ * @param stale contents the update partition starts out with, left by an earlier update.
+ * @return measurements.
+ */
+static ota_pipeline_bench_result_t ota_pipeline_bench_upload(idf_shim_request_t *request, const uint8_t *image, size_t image_len,
+		const uint8_t *stale)
+{
+	const esp_partition_t *update = esp_ota_get_next_update_partition(NULL);
+	ota_pipeline_bench_result_t result = { 0 };
+	idf_shim_flash_stats_t flash;
+
+	memcpy(idf_shim_flash_contents(update), stale, IDF_SHIM_PARTITION_SIZE);
+	idf_shim_ota_reset();
+	idf_shim_flash_reset_stats();
+	idf_shim_heap_reset_peak();
+
+	int64_t start = esp_timer_get_time();
+	if (idf_shim_httpd_run(request) != ESP_OK)
+	{
+		return result;
+	}
+	result.seconds = (esp_timer_get_time() - start) / ota_pipeline_bench_scale / 1e6;
+	result.peak_heap = idf_shim_heap_peak();
+
+	idf_shim_flash_get_stats(&flash);
+	result.flash_ms = flash.busy_us / 1000.0;
+	result.p50_ms = ota_pipeline_bench_percentile(request->latency_us, request->latency_count, 50);
+	result.p99_ms = ota_pipeline_bench_percentile(request->latency_us, request->latency_count, 99);
+	result.ok = strcmp(request->status, HTTPD_200) == 0 && esp_ota_get_boot_partition() == update &&
+			memcmp(idf_shim_flash_contents(update), image, image_len) == 0;
+	if (!result.ok)
+	{
+		fprintf(stderr, "ota_pipeline_bench: %s %s answered %s: %s\n", (request->method == HTTP_PUT) ? "PUT" : "POST", request->uri,
+				request->status, request->response);
+	}
+
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	size_t image_len = OTA_PIPELINE_BENCH_DEFAULT_KB * 1024;
+	const char *trace_path = NULL;
+	uint32_t trace_latency_us = 5000;
+	int failed = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "k:s:t:l:v")) != -1)
+	{
+		switch (opt)
+		{
+			case 'k':
+				image_len = (size_t)atoi(optarg) * 1024;
+				break;
+			case 's':
+				ota_pipeline_bench_scale = atof(optarg);
+				break;
+			case 't':
+				trace_path = optarg;
+				break;
+			case 'l':
+				trace_latency_us = atoi(optarg);
+				break;
+			case 'v':
+				idf_shim_set_log_level(ESP_LOG_INFO);
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-k image size in KB] [-s time scale] [-t trace file [-l latency in us]] [-v]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (image_len < 16 * 1024 || image_len > IDF_SHIM_PARTITION_SIZE / 2 || ota_pipeline_bench_scale <= 0)
+	{
+		fprintf(stderr, "ota_pipeline_bench: image size must be 16 to %u KB, the time scale above 0\n", IDF_SHIM_PARTITION_SIZE / 2048);
+		return 1;
+	}
+
+	size_t old_len = image_len - OTA_PIPELINE_BENCH_INSERT_LEN;
+	size_t insert_at = image_len / 3;
+	size_t cap = image_len + image_len / 8 + 1024;
+	uint8_t *image = malloc(image_len);
+	uint8_t *old_image = malloc(old_len);
+	uint8_t *stale = malloc(IDF_SHIM_PARTITION_SIZE);
+	uint8_t *payloads[OTA_PIPELINE_BENCH_ENCODING_COUNT] = { image, malloc(cap), malloc(cap) };
+	uint8_t *body = malloc(cap + 1024);
+	idf_shim_segment_t *traces = malloc(OTA_PIPELINE_BENCH_LINK_COUNT * OTA_PIPELINE_BENCH_TRACE_MAX * sizeof(idf_shim_segment_t));
+	uint32_t *latency_us = malloc((cap + 1024) * sizeof(uint32_t));
+	if (!image || !old_image || !stale || !payloads[1] || !payloads[2] || !body || !traces || !latency_us)
+	{
+		fprintf(stderr, "ota_pipeline_bench: Out of memory\n");
+		return 1;
+	}
+
+	// The new release inserts a function into the running one and changes a few constants,
+	// the update partition still holds an older release
+	fixture_firmware(image, image_len, 1);
+	memcpy(old_image, image, insert_at);
+	memcpy(&old_image[insert_at], &image[insert_at + OTA_PIPELINE_BENCH_INSERT_LEN], old_len - insert_at);
+	for (size_t i = 4099; i < old_len; i += 4099)
+	{
+		old_image[i] ^= 0x5A;
+	}
+	ota_pipeline_bench_stamp(image, image_len, OTA_PIPELINE_BENCH_UPDATE_VERSION);
+	ota_pipeline_bench_stamp(old_image, old_len, IDF_SHIM_RUNNING_VERSION);
+	fixture_firmware(stale, IDF_SHIM_PARTITION_SIZE, 7);
+
+	size_t payload_lens[OTA_PIPELINE_BENCH_ENCODING_COUNT] = {
+			image_len,
+			fixture_heatshrink_encode(image, image_len, payloads[1], cap),
+			fixture_bspatch_create(old_image, old_len, image, insert_at, OTA_PIPELINE_BENCH_INSERT_LEN, payloads[2], cap),
+	};
+
+	// The image is only booted if it matches the SHA-256 sent along
+	fixture_sha256_t sha;
+	uint8_t digest[OTA_DIGEST_LEN];
+	char digest_hex[OTA_DIGEST_HEX_LEN + 1];
+	fixture_sha256_init(&sha);
+	fixture_sha256_update(&sha, image, image_len);
+	fixture_sha256_finish(&sha, digest);
+	ota_digest_to_hex(digest, digest_hex);
+
+	// Socket traces: the links, or the trace file
+	const char *trace_names[OTA_PIPELINE_BENCH_LINK_COUNT];
+	idf_shim_socket_t sockets[OTA_PIPELINE_BENCH_LINK_COUNT];
+	size_t socket_count = 0;
+	if (trace_path != NULL)
+	{
+		size_t count = ota_pipeline_bench_read_trace(trace_path, traces, OTA_PIPELINE_BENCH_TRACE_MAX);
+		if (count == 0)
+		{
+			fprintf(stderr, "ota_pipeline_bench: No segments in %s\n", trace_path);
+			return 1;
+		}
+		trace_names[0] = "trace";
+		sockets[socket_count++] = (idf_shim_socket_t) {
+				.trace = traces, .trace_len = count, .latency_us = trace_latency_us, .window = CONFIG_LWIP_TCP_WND_DEFAULT,
+		};
+	}
+	else
+	{
+		for (size_t i = 0; i < OTA_PIPELINE_BENCH_LINK_COUNT; i++)
+		{
+			idf_shim_segment_t *trace = &traces[i * OTA_PIPELINE_BENCH_TRACE_MAX];
+
+			ota_pipeline_bench_link_trace(&ota_pipeline_bench_links[i], trace, OTA_PIPELINE_BENCH_TRACE_MAX);
+			trace_names[socket_count] = ota_pipeline_bench_links[i].name;
+			sockets[socket_count++] = (idf_shim_socket_t) {
+					.trace = trace, .trace_len = OTA_PIPELINE_BENCH_TRACE_MAX, .latency_us = ota_pipeline_bench_links[i].latency_us,
+					.window = CONFIG_LWIP_TCP_WND_DEFAULT,
+			};
+		}
+	}
+
+	idf_shim_set_time_scale(ota_pipeline_bench_scale);
+	idf_shim_flash_init(&ota_pipeline_bench_flash);
+	memcpy(idf_shim_flash_contents(esp_ota_get_running_partition()), old_image, old_len);
+	http_server_start();
+
+	printf("OTA pipeline with %d buffers of %d bytes, image %u bytes, heatshrink %u bytes, bsdiff patch %u bytes, time scale %.2f\n",
+			OTA_WRITER_BUFFER_COUNT, OTA_WRITER_BUFFER_SIZE, (unsigned)image_len, (unsigned)payload_lens[1], (unsigned)payload_lens[2], ota_pipeline_bench_scale);
+	printf("%-5s %-10s %-6s %9s %8s %7s %8s %8s %9s %8s %s\n", "path", "encoding", "socket", "upload KB", "time ms", "MB/s",
+			"p50 ms", "p99 ms", "flash ms", "heap KB", "result");
+
+	for (int form = 1; form >= 0; form--)
+	{
+		for (int encoding = 0; encoding < OTA_PIPELINE_BENCH_ENCODING_COUNT; encoding++)
+		{
+			for (size_t s = 0; s < socket_count; s++)
+			{
+				char uri[64];
+				idf_shim_request_t request = {
+						.method = form ? HTTP_POST : HTTP_PUT,
+						.uri = uri,
+						.headers = { { "X-Firmware-SHA256", digest_hex } },
+						.body = payloads[encoding],
+						.body_len = payload_lens[encoding],
+						.socket = &sockets[s],
+						.latency_us = latency_us,
+						.latency_cap = cap + 1024,
+				};
+
+				snprintf(uri, sizeof(uri), "%s%s", form ? "/OTAupdate" : "/firmware", ota_pipeline_bench_encoding_queries[encoding]);
+				if (form)
+				{
+					request.headers[1][0] = "Content-Type";
+					request.headers[1][1] = "multipart/form-data; boundary=" FIXTURE_BOUNDARY;
+					request.body = body;
+					request.body_len = fixture_multipart(payloads[encoding], payload_lens[encoding], body, cap + 1024);
+				}
+
+				ota_pipeline_bench_result_t result = ota_pipeline_bench_upload(&request, image, image_len, stale);
+
+				printf("%-5s %-10s %-6s %9u %8.0f %7.2f %8.1f %8.1f %9.0f %8.1f %s\n", form ? "form" : "raw",
+						ota_pipeline_bench_encoding_names[encoding], trace_names[s], (unsigned)(request.body_len / 1024), result.seconds * 1000,
+						result.ok ? image_len / result.seconds / (1024 * 1024) : 0, result.p50_ms, result.p99_ms, result.flash_ms,
+						result.peak_heap / 1024.0, result.ok ? "ok" : "FAILED");
+				failed |= !result.ok;
+			}
+		}
+	}
+
+	free(image);
+	free(old_image);
+	free(stale);
+	free(payloads[1]);
+	free(payloads[2]);
+	free(body);
+	free(traces);
+	free(latency_us);
+
+	return failed ? 1 : 0;
+}
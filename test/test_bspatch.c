@@ -0,0 +1,291 @@
+/*
+ * test_bspatch.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Round trips through the bsdiff patch applier: a patch created on the host against an old image
+ * must rebuild the new image whatever chunk sizes it arrives in.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bspatch.h"
+#include "fixtures.h"
+#include "test_check.h"
+
+/**
+ * Old image and rebuilt new image
+ */
+typedef struct test_images
+{
+	const uint8_t *old_image;
+	size_t old_len;
+	uint8_t *data;
+	size_t cap;
+	size_t len;
+	int read_error;					///> Value the read callback fails with, 0 to succeed
+} test_images_t;
+
+static int test_read_old(void *ctx, size_t offset, uint8_t *buf, size_t len)
+{
+	test_images_t *images = ctx;
+
+	if (images->read_error != 0)
+	{
+		return images->read_error;
+	}
+	if (offset + len > images->old_len)
+	{
+		return -100;
+	}
+	memcpy(buf, &images->old_image[offset], len);
+
+	return 0;
+}
+
+static int test_on_output(void *ctx, const uint8_t *data, size_t len)
+{
+	test_images_t *images = ctx;
+
+	if (images->len + len > images->cap)
+	{
+		return -1;
+	}
+	memcpy(&images->data[images->len], data, len);
+	images->len += len;
+
+	return 0;
+}
+
+/**
+ * Applies a patch fed in chunks of the given size.
+ * @return 0 on success, otherwise the error of bspatch_feed or bspatch_finish.
+ */
+static int test_apply(const uint8_t *patch_data, size_t len, size_t chunk, test_images_t *images)
+{
+	static bspatch_t patch;
+	int ret;
+
+	images->len = 0;
+	bspatch_init(&patch, images->old_len, test_read_old, test_on_output, images);
+	for (size_t pos = 0; pos < len; pos += chunk)
+	{
+		if ((ret = bspatch_feed(&patch, &patch_data[pos], (len - pos < chunk) ? len - pos : chunk)) != 0)
+		{
+			return ret;
+		}
+	}
+
+	return bspatch_finish(&patch);
+}
+
+/**
+ * Appends a control block to a patch being assembled.
+ */
+static uint8_t *test_put_control(uint8_t *p, int64_t diff_len, int64_t extra_len, int64_t seek)
+{
+	fixture_bspatch_offtout(diff_len, &p[0]);
+	fixture_bspatch_offtout(extra_len, &p[8]);
+	fixture_bspatch_offtout(seek, &p[16]);
+
+	return p + 24;
+}
+
+/**
+ * Starts a patch with the header.
+ */
+static uint8_t *test_put_header(uint8_t *p, int64_t new_size)
+{
+	memcpy(p, "ENDSLEY/BSDIFF43", 16);
+	fixture_bspatch_offtout(new_size, &p[16]);
+
+	return p + 24;
+}
+
+static void test_release_round_trip(void)
+{
+	static const size_t chunks[] = { 1, 3, 24, 25, 255, 256, 257, 1436, 4096, 1 << 20 };
+	size_t old_len = 200 * 1024;
+	size_t insert_at = 70001;
+	size_t insert_len = 777;
+	size_t new_len = old_len + insert_len;
+	uint8_t *new_image = malloc(new_len);
+	uint8_t *old_image = malloc(old_len);
+	uint8_t *patch = malloc(new_len + 1024);
+	test_images_t images = { .old_image = old_image, .old_len = old_len, .data = malloc(new_len), .cap = new_len };
+
+	// The new release adds a function and changes some constants of the old one
+	fixture_firmware(new_image, new_len, 21);
+	memcpy(old_image, new_image, insert_at);
+	memcpy(&old_image[insert_at], &new_image[insert_at + insert_len], old_len - insert_at);
+	for (size_t i = 0; i < old_len; i += 1021)
+	{
+		old_image[i] += 0x11;
+	}
+
+	size_t patch_len = fixture_bspatch_create(old_image, old_len, new_image, insert_at, insert_len, patch, new_len + 1024);
+	TEST_CHECK(patch_len > 0, "creating the patch failed");
+
+	for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++)
+	{
+		int ret = test_apply(patch, patch_len, chunks[c], &images);
+		TEST_CHECK(ret == 0, "%u byte chunks: error %d", (unsigned)chunks[c], ret);
+		TEST_CHECK(images.len == new_len && memcmp(images.data, new_image, new_len) == 0, "%u byte chunks: %u bytes of %u rebuilt",
+				(unsigned)chunks[c], (unsigned)images.len, (unsigned)new_len);
+	}
+
+	free(new_image);
+	free(old_image);
+	free(patch);
+	free(images.data);
+}
+
+static void test_seek_and_past_end(void)
+{
+	uint8_t old_image[550];
+	uint8_t expected[1000];
+	uint8_t rebuilt[1000];
+	uint8_t patch[2048];
+	uint8_t *p = patch;
+	test_images_t images = { .old_image = old_image, .old_len = sizeof(old_image), .data = rebuilt, .cap = sizeof(rebuilt) };
+
+	for (size_t i = 0; i < sizeof(old_image); i++)
+	{
+		old_image[i] = i * 7;
+	}
+
+	// old[0..400), then old[100..500) again after seeking back, then old[500..600) which ends past the old image and reads as zero there
+	p = test_put_header(p, 1000);
+	p = test_put_control(p, 400, 0, -300);
+	for (size_t i = 0; i < 400; i++)
+	{
+		*p++ = 0;
+		expected[i] = old_image[i];
+	}
+	p = test_put_control(p, 400, 100, 0);
+	for (size_t i = 0; i < 400; i++)
+	{
+		*p++ = 1;
+		expected[400 + i] = old_image[100 + i] + 1;
+	}
+	for (size_t i = 0; i < 100; i++)
+	{
+		*p++ = 0xEE;
+		expected[800 + i] = 0xEE;
+	}
+	p = test_put_control(p, 100, 0, 0);
+	for (size_t i = 0; i < 100; i++)
+	{
+		// Old position is 500, the second half is past the end of the old image
+		*p++ = 3;
+		expected[900 + i] = ((500 + i < sizeof(old_image)) ? old_image[500 + i] : 0) + 3;
+	}
+	size_t patch_len = p - patch;
+
+	// Split at every offset
+	for (size_t split = 0; split <= patch_len; split++)
+	{
+		static bspatch_t state;
+
+		images.len = 0;
+		bspatch_init(&state, images.old_len, test_read_old, test_on_output, &images);
+		int ret = bspatch_feed(&state, patch, split);
+		ret = ret ? ret : bspatch_feed(&state, &patch[split], patch_len - split);
+		ret = ret ? ret : bspatch_finish(&state);
+		TEST_CHECK(ret == 0 && images.len == sizeof(expected) && memcmp(rebuilt, expected, sizeof(expected)) == 0, "split at %u: error %d",
+				(unsigned)split, ret);
+	}
+}
+
+static void test_malformed(void)
+{
+	uint8_t old_image[64] = { 0 };
+	uint8_t rebuilt[256];
+	uint8_t patch[256];
+	uint8_t *p;
+	test_images_t images = { .old_image = old_image, .old_len = sizeof(old_image), .data = rebuilt, .cap = sizeof(rebuilt) };
+	int ret;
+
+	// Empty new image
+	p = test_put_header(patch, 0);
+	ret = test_apply(patch, p - patch, 1, &images);
+	TEST_CHECK(ret == 0 && images.len == 0, "empty image: error %d", ret);
+
+	// Bytes after the last block
+	*p++ = 0;
+	TEST_CHECK(test_apply(patch, p - patch, 64, &images) == -1, "trailing bytes accepted");
+
+	// Wrong magic
+	p = test_put_header(patch, 16);
+	patch[15] = '2';
+	TEST_CHECK(test_apply(patch, p - patch, 64, &images) == -1, "wrong magic accepted");
+
+	// Blocks larger than the new image
+	p = test_put_header(patch, 16);
+	p = test_put_control(p, 10, 10, 0);
+	TEST_CHECK(test_apply(patch, p - patch, 64, &images) == -1, "oversized block accepted");
+
+	// Negative length
+	p = test_put_header(patch, 16);
+	p = test_put_control(p, -1, 0, 0);
+	TEST_CHECK(test_apply(patch, p - patch, 64, &images) == -1, "negative length accepted");
+
+	// Lengths whose sum overflows int64_t
+	p = test_put_header(patch, 16);
+	p = test_put_control(p, 8, INT64_MAX - 4, 0);
+	TEST_CHECK(test_apply(patch, p - patch, 64, &images) == -1, "overflowing extra length accepted");
+
+	p = test_put_header(patch, 16);
+	p = test_put_control(p, INT64_MAX, INT64_MAX, 0);
+	TEST_CHECK(test_apply(patch, p - patch, 64, &images) == -1, "overflowing lengths accepted");
+
+	// New image larger than any partition
+	p = test_put_header(patch, INT64_MAX);
+	TEST_CHECK(test_apply(patch, p - patch, 64, &images) == -1, "huge new image accepted");
+
+	// Seeks which would overflow the old position, or leave the old image by more than the new image is long
+	p = test_put_header(patch, 16);
+	p = test_put_control(p, 0, 8, INT64_MAX);
+	memset(p, 0, 8);
+	p += 8;
+	TEST_CHECK(test_apply(patch, p - patch, 64, &images) == -1, "overflowing seek accepted");
+
+	p = test_put_header(patch, 16);
+	p = test_put_control(p, 0, 8, -INT64_MAX);
+	memset(p, 0, 8);
+	p += 8;
+	TEST_CHECK(test_apply(patch, p - patch, 64, &images) == -1, "overflowing negative seek accepted");
+
+	p = test_put_header(patch, 16);
+	p = test_put_control(p, 0, 8, sizeof(old_image) + 17);
+	memset(p, 0, 8);
+	p += 8;
+	TEST_CHECK(test_apply(patch, p - patch, 64, &images) == -1, "seek far past the old image accepted");
+
+	// Truncated in the middle of the diff block
+	p = test_put_header(patch, 16);
+	p = test_put_control(p, 16, 0, 0);
+	memset(p, 0, 8);
+	p += 8;
+	TEST_CHECK(test_apply(patch, p - patch, 64, &images) == -1, "truncated patch accepted");
+
+	// Failing read of the old image is passed on
+	p = test_put_header(patch, 16);
+	p = test_put_control(p, 16, 0, 0);
+	memset(p, 0, 16);
+	p += 16;
+	images.read_error = 7;
+	ret = test_apply(patch, p - patch, 64, &images);
+	TEST_CHECK(ret == 7, "read error not passed on: %d", ret);
+}
+
+int main(void)
+{
+	test_release_round_trip();
+	test_seek_and_past_end();
+	test_malformed();
+
+	return TEST_CHECK_RESULT();
+}
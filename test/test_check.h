@@ -0,0 +1,32 @@
+/*
+ * test_check.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Minimal checks for the host tests: a failed check is reported and the test carries on,
+ * main returns TEST_CHECK_RESULT() so ctest sees the failure.
+ */
+
+#ifndef TEST_TEST_CHECK_H_
+#define TEST_TEST_CHECK_H_
+
+#include <stdio.h>
+
+// Number of failed checks
+static int test_check_failures = 0;
+
+#define TEST_CHECK(cond, ...) \
+	do \
+	{ \
+		if (!(cond)) \
+		{ \
+			test_check_failures++; \
+			fprintf(stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__, #cond); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+		} \
+	} while (0)
+
+#define TEST_CHECK_RESULT()		(test_check_failures == 0 ? 0 : 1)
+
+#endif /* TEST_TEST_CHECK_H_ */
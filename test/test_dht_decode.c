@@ -0,0 +1,127 @@
+/*
+ * test_dht_decode.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Feeds recorded RMT captures of DHT11 and DHT22 frames, converted to pulses like dht_symbols_to_pulses does,
+ * to the frame decoder.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "dht_decode.h"
+#include "test_check.h"
+
+#define TEST_PULSE_COUNT(trace)		(sizeof(trace) / sizeof(trace[0]))
+
+// Bit timing of the model traits in dht.c
+static const dht_decode_timing_t test_dht11_timing = { .bit_threshold_us = 50, .pulse_max_us = 110 };
+static const dht_decode_timing_t test_dht22_timing = { .bit_threshold_us = 48, .pulse_max_us = 100 };
+
+// DHT11, 41% and 24 C: response, 40 bits, closing low
+static const dht_pulse_t test_dht11_trace[] = {
+		{ 80, 82 }, { 51, 25 }, { 49, 28 }, { 54, 71 }, { 50, 23 }, { 49, 68 }, { 54, 27 }, { 52, 29 },
+		{ 48, 69 }, { 56, 27 }, { 53, 25 }, { 50, 29 }, { 49, 25 }, { 51, 23 }, { 52, 29 }, { 52, 24 },
+		{ 50, 25 }, { 52, 28 }, { 53, 23 }, { 53, 28 }, { 54, 72 }, { 51, 69 }, { 51, 26 }, { 52, 23 },
+		{ 56, 29 }, { 52, 23 }, { 52, 27 }, { 52, 29 }, { 56, 24 }, { 54, 26 }, { 52, 26 }, { 55, 24 },
+		{ 51, 25 }, { 52, 29 }, { 48, 68 }, { 48, 26 }, { 52, 27 }, { 56, 28 }, { 55, 28 }, { 53, 24 },
+		{ 51, 68 }, { 53, 0 },
+};
+static const uint8_t test_dht11_frame[DHT_DECODE_FRAME_BYTES] = { 0x29, 0x00, 0x18, 0x00, 0x41 };
+
+// DHT22, 65.2% and -5.3 C
+static const dht_pulse_t test_dht22_trace[] = {
+		{ 80, 82 }, { 51, 28 }, { 55, 25 }, { 50, 25 }, { 54, 28 }, { 53, 28 }, { 56, 24 }, { 53, 68 },
+		{ 48, 28 }, { 51, 70 }, { 51, 23 }, { 53, 24 }, { 52, 26 }, { 48, 68 }, { 53, 73 }, { 49, 25 },
+		{ 53, 23 }, { 53, 70 }, { 53, 24 }, { 54, 29 }, { 49, 25 }, { 51, 26 }, { 52, 24 }, { 52, 26 },
+		{ 50, 25 }, { 48, 25 }, { 48, 26 }, { 50, 70 }, { 53, 70 }, { 49, 26 }, { 51, 71 }, { 51, 23 },
+		{ 48, 68 }, { 48, 28 }, { 50, 72 }, { 50, 27 }, { 48, 27 }, { 55, 27 }, { 51, 25 }, { 48, 68 },
+		{ 56, 70 }, { 53, 0 },
+};
+static const uint8_t test_dht22_frame[DHT_DECODE_FRAME_BYTES] = { 0x02, 0x8C, 0x80, 0x35, 0x43 };
+
+// DHT11, 47.0% and 22.5 C, with a glitch on the line before the response
+static const dht_pulse_t test_glitch_trace[] = {
+		{ 3, 12 }, { 81, 79 }, { 51, 23 }, { 54, 27 }, { 50, 74 }, { 52, 28 }, { 48, 74 }, { 50, 73 },
+		{ 55, 72 }, { 55, 73 }, { 54, 26 }, { 51, 29 }, { 48, 24 }, { 50, 23 }, { 52, 23 }, { 54, 29 },
+		{ 54, 24 }, { 56, 23 }, { 51, 24 }, { 53, 29 }, { 56, 29 }, { 55, 72 }, { 55, 23 }, { 49, 68 },
+		{ 49, 71 }, { 56, 29 }, { 52, 27 }, { 50, 23 }, { 53, 23 }, { 56, 23 }, { 52, 29 }, { 53, 74 },
+		{ 49, 23 }, { 56, 71 }, { 54, 24 }, { 52, 71 }, { 51, 29 }, { 55, 29 }, { 54, 68 }, { 49, 23 },
+		{ 53, 72 }, { 54, 26 }, { 55, 0 },
+};
+static const uint8_t test_glitch_frame[DHT_DECODE_FRAME_BYTES] = { 0x2F, 0x00, 0x16, 0x05, 0x4A };
+
+// Capture which timed out after 30 bits
+static const dht_pulse_t test_short_trace[] = {
+		{ 80, 82 }, { 51, 26 }, { 51, 24 }, { 55, 71 }, { 55, 23 }, { 51, 71 }, { 55, 24 }, { 54, 29 },
+		{ 51, 71 }, { 51, 23 }, { 48, 25 }, { 52, 24 }, { 56, 24 }, { 51, 26 }, { 52, 24 }, { 53, 23 },
+		{ 53, 27 }, { 49, 27 }, { 54, 28 }, { 48, 26 }, { 54, 68 }, { 54, 69 }, { 50, 25 }, { 52, 28 },
+		{ 55, 29 }, { 53, 29 }, { 54, 27 }, { 51, 28 }, { 52, 25 }, { 54, 26 }, { 49, 29 }, { 52, 0 },
+};
+
+/**
+ * Decodes a trace and checks the result and, for good frames, the frame bytes.
+ */
+static void test_trace(const char *name, const dht_pulse_t *pulses, size_t count, const dht_decode_timing_t *timing, dht_decode_result_e expected_result,
+		const uint8_t *expected_frame)
+{
+	uint8_t data[DHT_DECODE_FRAME_BYTES];
+
+	dht_decode_result_e result = dht_decode(pulses, count, timing, data);
+	TEST_CHECK(result == expected_result, "%s: result %d, expected %d", name, result, expected_result);
+	if (expected_frame != NULL)
+	{
+		TEST_CHECK(memcmp(data, expected_frame, sizeof(data)) == 0, "%s: decoded %02X %02X %02X %02X %02X", name, data[0], data[1], data[2],
+				data[3], data[4]);
+	}
+}
+
+static void test_good_frames(void)
+{
+	test_trace("dht11", test_dht11_trace, TEST_PULSE_COUNT(test_dht11_trace), &test_dht11_timing, DHT_DECODE_OK, test_dht11_frame);
+	test_trace("dht22", test_dht22_trace, TEST_PULSE_COUNT(test_dht22_trace), &test_dht22_timing, DHT_DECODE_OK, test_dht22_frame);
+	test_trace("glitch", test_glitch_trace, TEST_PULSE_COUNT(test_glitch_trace), &test_dht11_timing, DHT_DECODE_OK, test_glitch_frame);
+
+	// The closing low may be missing if the capture buffer filled up
+	test_trace("no closing low", test_dht11_trace, TEST_PULSE_COUNT(test_dht11_trace) - 1, &test_dht11_timing, DHT_DECODE_OK, test_dht11_frame);
+
+	// Without the response pulse the last 40 pulses are still the frame
+	test_trace("no response", &test_dht11_trace[1], TEST_PULSE_COUNT(test_dht11_trace) - 1, &test_dht11_timing, DHT_DECODE_OK, test_dht11_frame);
+}
+
+static void test_bad_frames(void)
+{
+	dht_pulse_t trace[TEST_PULSE_COUNT(test_dht11_trace)];
+
+	test_trace("short", test_short_trace, TEST_PULSE_COUNT(test_short_trace), &test_dht11_timing, DHT_DECODE_SHORT_FRAME, NULL);
+	test_trace("empty", test_dht11_trace, 0, &test_dht11_timing, DHT_DECODE_SHORT_FRAME, NULL);
+
+	// A '0' of the temperature read as a '1'
+	memcpy(trace, test_dht11_trace, sizeof(trace));
+	trace[1 + 16 + 7].high_us = 70;
+	test_trace("flipped bit", trace, TEST_PULSE_COUNT(trace), &test_dht11_timing, DHT_DECODE_CHECKSUM, NULL);
+
+	// Interference stretching a high
+	memcpy(trace, test_dht11_trace, sizeof(trace));
+	trace[20].high_us = 140;
+	test_trace("long high", trace, TEST_PULSE_COUNT(trace), &test_dht11_timing, DHT_DECODE_BAD_TIMING, NULL);
+
+	// A low held longer than a bit can take
+	memcpy(trace, test_dht11_trace, sizeof(trace));
+	trace[35].low_us = 120;
+	test_trace("long low", trace, TEST_PULSE_COUNT(trace), &test_dht11_timing, DHT_DECODE_BAD_TIMING, NULL);
+
+	// A slow DHT11 low is within the DHT11 window, but too long for a DHT22
+	trace[35].low_us = 105;
+	test_trace("slow dht11 low", trace, TEST_PULSE_COUNT(trace), &test_dht11_timing, DHT_DECODE_OK, test_dht11_frame);
+	test_trace("slow dht11 low as dht22", trace, TEST_PULSE_COUNT(trace), &test_dht22_timing, DHT_DECODE_BAD_TIMING, NULL);
+}
+
+int main(void)
+{
+	test_good_frames();
+	test_bad_frames();
+
+	return TEST_CHECK_RESULT();
+}
@@ -0,0 +1,190 @@
+/*
+ * test_heatshrink_decoder.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Round trips through the heatshrink decoder: data compressed on the host must decode to itself
+ * whatever chunk sizes the compressed stream arrives in.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fixtures.h"
+#include "heatshrink_decoder.h"
+#include "test_check.h"
+
+/**
+ * Decoded bytes
+ */
+typedef struct test_output
+{
+	uint8_t *data;
+	size_t cap;
+	size_t len;
+} test_output_t;
+
+static int test_on_output(void *ctx, const uint8_t *data, size_t len)
+{
+	test_output_t *output = ctx;
+
+	if (output->len + len > output->cap)
+	{
+		return -1;
+	}
+	memcpy(&output->data[output->len], data, len);
+	output->len += len;
+
+	return 0;
+}
+
+/**
+ * Callback rejecting any output.
+ */
+static int test_on_output_abort(void *ctx, const uint8_t *data, size_t len)
+{
+	(void)ctx;
+	(void)data;
+	(void)len;
+
+	return 5;
+}
+
+/**
+ * Decodes a stream fed in chunks of the given size.
+ * @return 0 on success, otherwise the decoder error.
+ */
+static int test_decode(const uint8_t *stream, size_t len, size_t chunk, test_output_t *output)
+{
+	static heatshrink_decoder_t decoder;
+	int ret;
+
+	output->len = 0;
+	heatshrink_decoder_init(&decoder, test_on_output, output);
+	for (size_t pos = 0; pos < len; pos += chunk)
+	{
+		if ((ret = heatshrink_decoder_feed(&decoder, &stream[pos], (len - pos < chunk) ? len - pos : chunk)) != 0)
+		{
+			return ret;
+		}
+	}
+
+	return heatshrink_decoder_finish(&decoder);
+}
+
+/**
+ * Compresses data and checks it decodes back to itself in every chunk size given.
+ */
+static void test_round_trip(const char *name, const uint8_t *data, size_t len, const size_t *chunks, size_t chunk_count)
+{
+	size_t cap = len + len / 8 + 16;
+	uint8_t *stream = malloc(cap);
+	test_output_t output = { .data = malloc(len + 1), .cap = len + 1 };
+
+	size_t stream_len = fixture_heatshrink_encode(data, len, stream, cap);
+	TEST_CHECK(stream_len > 0 || len == 0, "%s: encoding failed", name);
+
+	for (size_t c = 0; c < chunk_count; c++)
+	{
+		int ret = test_decode(stream, stream_len, chunks[c], &output);
+		TEST_CHECK(ret == 0, "%s in %u byte chunks: error %d", name, (unsigned)chunks[c], ret);
+		TEST_CHECK(output.len == len && memcmp(output.data, data, len) == 0, "%s in %u byte chunks: %u bytes of %u decoded",
+				name, (unsigned)chunks[c], (unsigned)output.len, (unsigned)len);
+	}
+
+	free(stream);
+	free(output.data);
+}
+
+static void test_known_stream(void)
+{
+	// "abc" as literals, then a backref 3 bytes back copying 6 bytes: it overlaps what it produces
+	static const uint8_t stream[] = { 0xB0, 0xD8, 0xAC, 0x60, 0x04, 0xA0 };
+	uint8_t buf[16];
+	test_output_t output = { .data = buf, .cap = sizeof(buf) };
+
+	for (size_t chunk = 1; chunk <= sizeof(stream); chunk++)
+	{
+		int ret = test_decode(stream, sizeof(stream), chunk, &output);
+		TEST_CHECK(ret == 0 && output.len == 9 && memcmp(buf, "abcabcabc", 9) == 0, "known stream in %u byte chunks", (unsigned)chunk);
+	}
+}
+
+static void test_round_trips(void)
+{
+	static const size_t chunks[] = { 1, 2, 3, 7, 64, 1436, 4096, 1 << 20 };
+	static const size_t chunk_count = sizeof(chunks) / sizeof(chunks[0]);
+	size_t len = 256 * 1024;
+	uint8_t *data = calloc(len, 1);
+
+	test_round_trip("empty", data, 0, chunks, chunk_count);
+
+	data[0] = 0x5A;
+	test_round_trip("one byte", data, 1, chunks, chunk_count);
+
+	// Long runs: back references overlapping their own output
+	memset(data, 0xFF, 10000);
+	test_round_trip("erased flash", data, 10000, chunks, chunk_count);
+
+	// Incompressible data: literals only
+	uint32_t state = 3;
+	for (size_t i = 0; i < 10000; i++)
+	{
+		state = state * 1664525u + 1013904223u;
+		data[i] = state >> 24;
+	}
+	test_round_trip("random", data, 10000, chunks, chunk_count);
+
+	// Much larger than the window, back references wrap around it
+	fixture_firmware(data, len, 11);
+	test_round_trip("firmware", data, len, chunks, chunk_count);
+
+	free(data);
+}
+
+static void test_split_at_every_offset(void)
+{
+	size_t len = 6000;
+	uint8_t *data = malloc(len);
+	uint8_t *stream = malloc(2 * len);
+	test_output_t output = { .data = malloc(len), .cap = len };
+	static heatshrink_decoder_t decoder;
+
+	fixture_firmware(data, len, 5);
+	size_t stream_len = fixture_heatshrink_encode(data, len, stream, 2 * len);
+
+	for (size_t split = 0; split <= stream_len; split++)
+	{
+		output.len = 0;
+		heatshrink_decoder_init(&decoder, test_on_output, &output);
+		int ret = heatshrink_decoder_feed(&decoder, stream, split);
+		ret = ret ? ret : heatshrink_decoder_feed(&decoder, &stream[split], stream_len - split);
+		ret = ret ? ret : heatshrink_decoder_finish(&decoder);
+		TEST_CHECK(ret == 0 && output.len == len && memcmp(output.data, data, len) == 0, "split at %u", (unsigned)split);
+	}
+
+	free(data);
+	free(stream);
+	free(output.data);
+}
+
+static void test_callback_abort(void)
+{
+	static const uint8_t stream[] = { 0xB0, 0xD8, 0xAC, 0x60, 0x04, 0xA0 };
+	static heatshrink_decoder_t decoder;
+
+	heatshrink_decoder_init(&decoder, test_on_output_abort, NULL);
+	int ret = heatshrink_decoder_feed(&decoder, stream, sizeof(stream));
+	TEST_CHECK(ret == 5, "callback error not passed on: %d", ret);
+}
+
+int main(void)
+{
+	test_known_stream();
+	test_round_trips();
+	test_split_at_every_offset();
+	test_callback_abort();
+
+	return TEST_CHECK_RESULT();
+}
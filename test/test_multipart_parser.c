@@ -0,0 +1,246 @@
+/*
+ * test_multipart_parser.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Feeds recorded browser uploads to the multipart parser split at every byte offset,
+ * the image bytes must come out unchanged whatever the split.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fixtures.h"
+#include "multipart_parser.h"
+#include "test_check.h"
+
+/**
+ * Recorded upload
+ */
+typedef struct test_upload
+{
+	const char *name;
+	const char *content_type;
+	const char *body;
+	size_t body_len;
+	const char *file;
+	size_t file_len;
+} test_upload_t;
+
+// File contents which look like delimiters: CR, LF, dashes and a prefix of the boundary
+#define TEST_FILE_CHROME	"\xE9\x03\x02\x20\r\n-\r\n--\r\n--" "----WebKitFormBoundary\r\r\n\x00\xFF"
+#define TEST_FILE_FIREFOX	"\xE9\x03\x02\x20\r\n---------------------------26500\n\r\n"
+
+#define TEST_STR_LEN(s)		(sizeof(s) - 1)
+
+// Uploads recorded from app.js, the file part is followed by nothing in Chrome and by an epilogue CRLF in Firefox
+static const test_upload_t test_uploads[] = {
+		{
+				.name = "chrome",
+				.content_type = "multipart/form-data; boundary=----WebKitFormBoundaryhV3nL0oWv2aXcQ9E",
+				.body = "------WebKitFormBoundaryhV3nL0oWv2aXcQ9E\r\n"
+						"Content-Disposition: form-data; name=\"file\"; filename=\"OTA_UPDATE.bin\"\r\n"
+						"Content-Type: application/octet-stream\r\n"
+						"\r\n"
+						TEST_FILE_CHROME
+						"\r\n------WebKitFormBoundaryhV3nL0oWv2aXcQ9E--\r\n",
+				.body_len = TEST_STR_LEN("------WebKitFormBoundaryhV3nL0oWv2aXcQ9E\r\n"
+						"Content-Disposition: form-data; name=\"file\"; filename=\"OTA_UPDATE.bin\"\r\n"
+						"Content-Type: application/octet-stream\r\n"
+						"\r\n"
+						TEST_FILE_CHROME
+						"\r\n------WebKitFormBoundaryhV3nL0oWv2aXcQ9E--\r\n"),
+				.file = TEST_FILE_CHROME,
+				.file_len = TEST_STR_LEN(TEST_FILE_CHROME),
+		},
+		{
+				.name = "firefox",
+				.content_type = "multipart/form-data; boundary=---------------------------265001916915724",
+				.body = "-----------------------------265001916915724\r\n"
+						"Content-Disposition: form-data; name=\"file\"; filename=\"OTA_UPDATE.bin\"\r\n"
+						"Content-Type: application/octet-stream\r\n"
+						"\r\n"
+						TEST_FILE_FIREFOX
+						"\r\n-----------------------------265001916915724\r\n"
+						"Content-Disposition: form-data; name=\"note\"\r\n"
+						"\r\n"
+						"second part, not part of the image"
+						"\r\n-----------------------------265001916915724--\r\n",
+				.body_len = TEST_STR_LEN("-----------------------------265001916915724\r\n"
+						"Content-Disposition: form-data; name=\"file\"; filename=\"OTA_UPDATE.bin\"\r\n"
+						"Content-Type: application/octet-stream\r\n"
+						"\r\n"
+						TEST_FILE_FIREFOX
+						"\r\n-----------------------------265001916915724\r\n"
+						"Content-Disposition: form-data; name=\"note\"\r\n"
+						"\r\n"
+						"second part, not part of the image"
+						"\r\n-----------------------------265001916915724--\r\n"),
+				.file = TEST_FILE_FIREFOX,
+				.file_len = TEST_STR_LEN(TEST_FILE_FIREFOX),
+		},
+};
+
+#define TEST_UPLOAD_COUNT	(sizeof(test_uploads) / sizeof(test_uploads[0]))
+
+/**
+ * Collected image bytes
+ */
+typedef struct test_output
+{
+	uint8_t *data;
+	size_t cap;
+	size_t len;
+} test_output_t;
+
+static int test_on_data(void *ctx, const uint8_t *data, size_t len)
+{
+	test_output_t *output = ctx;
+
+	if (output->len + len > output->cap)
+	{
+		return -1;
+	}
+	memcpy(&output->data[output->len], data, len);
+	output->len += len;
+
+	return 0;
+}
+
+/**
+ * Parses a body fed in pieces ending at the given offsets.
+ * @return result of the last feed.
+ */
+static multipart_parser_result_e test_parse(const char *content_type, const uint8_t *body, size_t body_len, const size_t *splits, size_t split_count,
+		test_output_t *output)
+{
+	multipart_parser_t parser;
+	multipart_parser_result_e result = MULTIPART_PARSER_OK;
+	size_t pos = 0;
+
+	output->len = 0;
+	if (multipart_parser_init(&parser, content_type, test_on_data, output) != 0)
+	{
+		return MULTIPART_PARSER_ERROR;
+	}
+
+	for (size_t s = 0; s <= split_count && result == MULTIPART_PARSER_OK; s++)
+	{
+		size_t end = (s < split_count) ? splits[s] : body_len;
+		result = multipart_parser_feed(&parser, &body[pos], end - pos);
+		pos = end;
+	}
+
+	return result;
+}
+
+/**
+ * Checks that the parse gave back the file.
+ */
+static void test_expect_file(const char *name, multipart_parser_result_e result, const test_output_t *output, const void *file, size_t file_len,
+		size_t split_a, size_t split_b)
+{
+	TEST_CHECK(result == MULTIPART_PARSER_DONE, "%s split at %u/%u: result %d", name, (unsigned)split_a, (unsigned)split_b, result);
+	TEST_CHECK(output->len == file_len && memcmp(output->data, file, file_len) == 0, "%s split at %u/%u: %u bytes of %u", name,
+			(unsigned)split_a, (unsigned)split_b, (unsigned)output->len, (unsigned)file_len);
+}
+
+static void test_recorded_uploads(void)
+{
+	uint8_t buf[256];
+	test_output_t output = { .data = buf, .cap = sizeof(buf) };
+
+	for (size_t u = 0; u < TEST_UPLOAD_COUNT; u++)
+	{
+		const test_upload_t *upload = &test_uploads[u];
+		const uint8_t *body = (const uint8_t *)upload->body;
+
+		// Two pieces, split at every offset
+		for (size_t a = 0; a <= upload->body_len; a++)
+		{
+			multipart_parser_result_e result = test_parse(upload->content_type, body, upload->body_len, &a, 1, &output);
+			test_expect_file(upload->name, result, &output, upload->file, upload->file_len, a, a);
+		}
+
+		// Three pieces, split at every pair of offsets
+		for (size_t a = 0; a <= upload->body_len; a++)
+		{
+			for (size_t b = a; b <= upload->body_len; b++)
+			{
+				size_t splits[2] = { a, b };
+				multipart_parser_result_e result = test_parse(upload->content_type, body, upload->body_len, splits, 2, &output);
+				test_expect_file(upload->name, result, &output, upload->file, upload->file_len, a, b);
+			}
+		}
+	}
+}
+
+static void test_byte_by_byte(void)
+{
+	uint8_t buf[256];
+	size_t splits[1024];
+	test_output_t output = { .data = buf, .cap = sizeof(buf) };
+
+	for (size_t u = 0; u < TEST_UPLOAD_COUNT; u++)
+	{
+		const test_upload_t *upload = &test_uploads[u];
+
+		for (size_t i = 0; i < upload->body_len; i++)
+		{
+			splits[i] = i;
+		}
+		multipart_parser_result_e result = test_parse(upload->content_type, (const uint8_t *)upload->body, upload->body_len, splits, upload->body_len,
+				&output);
+		test_expect_file(upload->name, result, &output, upload->file, upload->file_len, 1, 1);
+	}
+}
+
+static void test_image_upload(void)
+{
+	size_t file_len = 8192;
+	uint8_t *file = malloc(file_len);
+	uint8_t *body = malloc(file_len + 512);
+	test_output_t output = { .data = malloc(file_len), .cap = file_len };
+
+	fixture_firmware(file, file_len, 7);
+	size_t body_len = fixture_multipart(file, file_len, body, file_len + 512);
+
+	for (size_t a = 0; a <= body_len; a++)
+	{
+		multipart_parser_result_e result = test_parse("multipart/form-data; boundary=\"" FIXTURE_BOUNDARY "\"", body, body_len, &a, 1, &output);
+		test_expect_file("image", result, &output, file, file_len, a, a);
+	}
+
+	free(file);
+	free(body);
+	free(output.data);
+}
+
+static void test_malformed(void)
+{
+	multipart_parser_t parser;
+	uint8_t buf[256];
+	test_output_t output = { .data = buf, .cap = sizeof(buf) };
+	const test_upload_t *upload = &test_uploads[0];
+
+	TEST_CHECK(multipart_parser_init(&parser, "application/octet-stream", test_on_data, &output) != 0, "not multipart");
+	TEST_CHECK(multipart_parser_init(&parser, "multipart/form-data", test_on_data, &output) != 0, "no boundary");
+	TEST_CHECK(multipart_parser_init(&parser, "multipart/form-data; boundary=", test_on_data, &output) != 0, "empty boundary");
+
+	// Cut off before the closing boundary
+	size_t cut = upload->body_len - 8;
+	multipart_parser_result_e result = test_parse(upload->content_type, (const uint8_t *)upload->body, cut, NULL, 0, &output);
+	TEST_CHECK(result == MULTIPART_PARSER_OK, "truncated body: result %d", result);
+	TEST_CHECK(output.len <= upload->file_len, "truncated body: %u bytes passed on", (unsigned)output.len);
+}
+
+int main(void)
+{
+	test_recorded_uploads();
+	test_byte_by_byte();
+	test_image_upload();
+	test_malformed();
+
+	return TEST_CHECK_RESULT();
+}
@@ -0,0 +1,172 @@
+/*
+ * test_ota_digest.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * SHA-256 verification of uploads: the digest a client gives in hex has to match the hash of the image
+ * taken as it streams through the OTA writer, and has to stop matching when a byte of the image changes.
+ * The image is hashed by the host reference implementation, the parsing and the comparison
+ * ota_writer_complete decides on are the firmware's.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fixtures.h"
+#include "ota_digest.h"
+#include "test_check.h"
+
+// Buffers of the OTA writer hold one flash sector
+#define TEST_SECTOR_SIZE		4096
+
+// SHA-256 of "abc" (FIPS 180-2)
+static const char test_abc_hex[] = "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+
+/**
+ * Hashes an image in pieces of the given size, the way the OTA writer hashes each buffer after writing it.
+ */
+static void test_stream_digest(const uint8_t *image, size_t len, size_t chunk, uint8_t *digest)
+{
+	fixture_sha256_t sha;
+
+	fixture_sha256_init(&sha);
+	for (size_t pos = 0; pos < len; pos += chunk)
+	{
+		fixture_sha256_update(&sha, &image[pos], (len - pos < chunk) ? len - pos : chunk);
+	}
+	fixture_sha256_finish(&sha, digest);
+}
+
+static void test_hex(void)
+{
+	uint8_t digest[OTA_DIGEST_LEN];
+	uint8_t upper[OTA_DIGEST_LEN];
+	char hex[OTA_DIGEST_HEX_LEN + 1];
+	char malformed[OTA_DIGEST_HEX_LEN + 2];
+
+	TEST_CHECK(ota_digest_from_hex(test_abc_hex, digest), "well formed digest rejected");
+	TEST_CHECK(digest[0] == 0xBA && digest[31] == 0xAD, "digest converted wrong");
+
+	ota_digest_to_hex(digest, hex);
+	TEST_CHECK(strcmp(hex, test_abc_hex) == 0, "formatted as %s", hex);
+
+	// Clients may send upper case digits
+	for (int i = 0; i < OTA_DIGEST_HEX_LEN; i++)
+	{
+		malformed[i] = (hex[i] >= 'a') ? hex[i] - 'a' + 'A' : hex[i];
+	}
+	malformed[OTA_DIGEST_HEX_LEN] = '\0';
+	TEST_CHECK(ota_digest_from_hex(malformed, upper) && memcmp(upper, digest, sizeof(digest)) == 0, "upper case digest rejected");
+
+	// Anything but exactly 64 hex digits is malformed, in particular a digest cut short by a buffer
+	TEST_CHECK(!ota_digest_from_hex(NULL, digest), "NULL accepted");
+	TEST_CHECK(!ota_digest_from_hex("", digest), "empty digest accepted");
+
+	strcpy(malformed, test_abc_hex);
+	malformed[OTA_DIGEST_HEX_LEN - 1] = '\0';
+	TEST_CHECK(!ota_digest_from_hex(malformed, digest), "63 digits accepted");
+
+	strcpy(malformed, test_abc_hex);
+	strcat(malformed, "0");
+	TEST_CHECK(!ota_digest_from_hex(malformed, digest), "65 digits accepted");
+
+	strcpy(malformed, test_abc_hex);
+	malformed[10] = 'g';
+	TEST_CHECK(!ota_digest_from_hex(malformed, digest), "non hex digit accepted");
+
+	strcpy(malformed, test_abc_hex);
+	malformed[0] = ' ';
+	TEST_CHECK(!ota_digest_from_hex(malformed, digest), "leading space accepted");
+
+	memcpy(malformed, "0x", 2);
+	TEST_CHECK(!ota_digest_from_hex(malformed, digest), "0x prefix accepted");
+}
+
+static void test_reference(void)
+{
+	uint8_t expected[OTA_DIGEST_LEN];
+	uint8_t digest[OTA_DIGEST_LEN];
+
+	ota_digest_from_hex(test_abc_hex, expected);
+	test_stream_digest((const uint8_t *)"abc", 3, 1, digest);
+	TEST_CHECK(memcmp(digest, expected, sizeof(digest)) == 0, "reference SHA-256 of \"abc\" wrong");
+
+	ota_digest_from_hex("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", expected);
+	test_stream_digest(NULL, 0, 1, digest);
+	TEST_CHECK(memcmp(digest, expected, sizeof(digest)) == 0, "reference SHA-256 of nothing wrong");
+}
+
+static void test_match_and_mismatch(void)
+{
+	static const size_t chunks[] = { 1, 63, 64, 65, 1436, TEST_SECTOR_SIZE };
+	size_t len = 300 * 1024 + 123;
+	uint8_t *image = malloc(len);
+	uint8_t expected[OTA_DIGEST_LEN];
+	uint8_t digest[OTA_DIGEST_LEN];
+	char hex[OTA_DIGEST_HEX_LEN + 1];
+
+	fixture_firmware(image, len, 31);
+
+	// The client hashes the file it uploads in one go and sends the digest in hex
+	test_stream_digest(image, len, len, digest);
+	ota_digest_to_hex(digest, hex);
+	TEST_CHECK(ota_digest_from_hex(hex, expected), "client digest rejected");
+
+	// Hashed while streaming, in whatever pieces the image arrives in, it matches
+	for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++)
+	{
+		test_stream_digest(image, len, chunks[c], digest);
+		TEST_CHECK(ota_digest_matches(digest, expected), "intact image does not match in %u byte pieces", (unsigned)chunks[c]);
+	}
+
+	// A single flipped bit anywhere does not
+	static const size_t corrupt[] = { 0, 4095, 4096, 150000 };
+	for (size_t c = 0; c < sizeof(corrupt) / sizeof(corrupt[0]); c++)
+	{
+		image[corrupt[c]] ^= 0x01;
+		test_stream_digest(image, len, TEST_SECTOR_SIZE, digest);
+		TEST_CHECK(!ota_digest_matches(digest, expected), "image corrupted at %u matches", (unsigned)corrupt[c]);
+		image[corrupt[c]] ^= 0x01;
+	}
+
+	// Neither does an image missing its last sector
+	test_stream_digest(image, len - TEST_SECTOR_SIZE, TEST_SECTOR_SIZE, digest);
+	TEST_CHECK(!ota_digest_matches(digest, expected), "truncated image matches");
+
+	free(image);
+}
+
+static void test_compare(void)
+{
+	uint8_t expected[OTA_DIGEST_LEN];
+	uint8_t digest[OTA_DIGEST_LEN];
+
+	ota_digest_from_hex(test_abc_hex, expected);
+	memcpy(digest, expected, sizeof(digest));
+	TEST_CHECK(ota_digest_matches(digest, expected), "equal digests do not match");
+
+	// A difference in any bit of any byte rejects the image, the comparison does not stop early or skip bytes
+	for (int i = 0; i < OTA_DIGEST_LEN; i++)
+	{
+		for (int bit = 0; bit < 8; bit++)
+		{
+			digest[i] ^= 1 << bit;
+			TEST_CHECK(!ota_digest_matches(digest, expected), "bit %d of byte %d not compared", bit, i);
+			digest[i] ^= 1 << bit;
+		}
+	}
+
+	memset(digest, 0, sizeof(digest));
+	TEST_CHECK(!ota_digest_matches(digest, expected), "zero digest matches");
+}
+
+int main(void)
+{
+	test_hex();
+	test_compare();
+	test_reference();
+	test_match_and_mismatch();
+
+	return TEST_CHECK_RESULT();
+}